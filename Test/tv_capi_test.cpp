@@ -0,0 +1,86 @@
+
+#include "tvmin.h"
+#include "tv_engine.h"
+#include "gtest/gtest.h"
+#include <vector>
+
+
+int main(int argc, char **argv) {
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+auto GetPhantom(const size_t sz)
+{
+	std::vector<float> out(sz);
+	unsigned int seed = 2018u;
+	for (size_t ind = 0; ind < sz; ++ind)
+	{
+		seed = seed * 1103515245u + 12345u;
+		out[ind] = ((ind / 5) % 2 ? 80.f : 30.f) + static_cast<float>((seed >> 16) % 32);
+	}
+	return out;
+}
+
+TEST(CApi, MatchesEngine)
+{
+	const std::vector<size_t> imSize{ 14, 12, 9 };
+	const std::vector<float> spacing{ 0.8f, 0.8f, 2.f };
+	const auto in = GetPhantom(14 * 12 * 9);
+
+	tvmin_params params;
+	tvmin_default_params(&params);
+	params.lambda = 15.f;
+	params.iterations = 12;
+	params.use_spacing = 1;
+	std::vector<float> out(std::size(in));
+	ASSERT_EQ(tvmin_solve_f32(std::data(in), std::data(out), 3, std::data(imSize), std::data(spacing), &params), TVMIN_OK);
+
+	TVengine engine;
+	engine.setLambda(15.f);
+	engine.setIt(12);
+	TVimage<false> im(imSize);
+	im.setScaling(TVengine::computeScaling(spacing));
+	std::vector<float> ref(std::size(in));
+	engine.run(std::data(in), im, std::data(ref));
+
+	for (size_t ind = 0; ind < std::size(ref); ++ind)
+	{
+		ASSERT_NEAR(out[ind], ref[ind], 1e-3f);
+	}
+}
+
+TEST(CApi, InPlace)
+{
+	const std::vector<size_t> imSize{ 10, 11, 7 };
+	auto in = GetPhantom(10 * 11 * 7);
+
+	tvmin_params params;
+	tvmin_default_params(&params);
+	params.lambda = 8.f;
+	params.slice_by_slice = 1;
+	std::vector<float> out(std::size(in));
+	ASSERT_EQ(tvmin_solve_f32(std::data(in), std::data(out), 3, std::data(imSize), nullptr, &params), TVMIN_OK);
+	ASSERT_EQ(tvmin_solve_f32(std::data(in), std::data(in), 3, std::data(imSize), nullptr, &params), TVMIN_OK);
+	for (size_t ind = 0; ind < std::size(out); ++ind)
+	{
+		ASSERT_FLOAT_EQ(in[ind], out[ind]);
+	}
+}
+
+TEST(CApi, InvalidArguments)
+{
+	const size_t imSize[2]{ 4, 0 };
+	float buffer[16] = {};
+	tvmin_params params;
+	tvmin_default_params(&params);
+
+	EXPECT_EQ(tvmin_solve_f32(buffer, buffer, 2, imSize, nullptr, &params), TVMIN_INVALID_ARGUMENT);
+	EXPECT_EQ(tvmin_solve_f32(nullptr, buffer, 1, imSize, nullptr, &params), TVMIN_INVALID_ARGUMENT);
+	params.use_spacing = 1;
+	EXPECT_EQ(tvmin_solve_f32(buffer, buffer, 1, imSize, nullptr, &params), TVMIN_INVALID_ARGUMENT);
+	params.use_spacing = 0;
+	params.iterations = 0;
+	EXPECT_EQ(tvmin_solve_f32(buffer, buffer, 1, imSize, nullptr, &params), TVMIN_INVALID_ARGUMENT);
+	EXPECT_EQ(tvmin_solve_f32(buffer, buffer, 1, imSize, nullptr, nullptr), TVMIN_OK);
+}
@@ -0,0 +1,236 @@
+
+#include "tv_engine.h"
+#include "tv_reference.h"
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+
+int main(int argc, char **argv) {
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+constexpr unsigned int CASE_NUM = 40;
+
+/*Relative tolerance of the float engine against the double reference*/
+constexpr double TOLERANCE = 1e-3;
+
+/*Relative tolerance between the engine variants, they differ only by contraction of float operations*/
+constexpr double VARIANT_TOLERANCE = 1e-5;
+
+struct TestCase
+{
+	std::vector<size_t> size;
+	std::vector<float> spacing;
+	bool isIso = true;
+	bool sliceBySlice = false;
+	float lambda = 10.f;
+	unsigned int it = 10;
+	std::vector<float> in;
+};
+
+struct Variant
+{
+	std::string name;
+	TVconfig config;
+};
+
+/*Blocky phantom with uniform noise, random but reproducible*/
+auto GetCase(std::mt19937& gen)
+{
+	TestCase out;
+	const auto dim = std::uniform_int_distribution<size_t>(2, 3)(gen);
+	std::uniform_int_distribution<size_t> length(1, 14);
+	std::uniform_real_distribution<float> spacing(0.3f, 3.f);
+	size_t sz = 1;
+	for (size_t d = 0; d < dim; ++d)
+	{
+		out.size.emplace_back(length(gen));
+		out.spacing.emplace_back(spacing(gen));
+		sz *= out.size.back();
+	}
+	out.isIso = std::bernoulli_distribution(0.5)(gen);
+	out.sliceBySlice = 3 == dim && std::bernoulli_distribution(0.3)(gen);
+	out.lambda = std::uniform_real_distribution<float>(1.f, 50.f)(gen);
+	out.it = std::uniform_int_distribution<unsigned int>(1, 25)(gen);
+
+	const float range = std::uniform_real_distribution<float>(10.f, 1000.f)(gen);
+	std::uniform_real_distribution<float> noise(0.f, 0.3f * range);
+	const size_t block = std::uniform_int_distribution<size_t>(2, 9)(gen);
+	out.in.resize(sz);
+	for (size_t ind = 0; ind < sz; ++ind)
+		out.in[ind] = ((ind / block) % 2 ? range : 0.2f * range) + noise(gen);
+	return out;
+}
+
+auto GetVariants()
+{
+	std::vector<Variant> out;
+	Variant var;
+	var.name = "operator";
+	out.emplace_back(var);
+	var.name = "operator 3 threads";
+	var.config.threads = 3;
+	out.emplace_back(var);
+	var.config.kernel = TVkernel::FUSED;
+	for (auto threads : { 1u, 2u, 3u })
+	{
+		for (auto tile : { 1u, 2u })
+		{
+			var.config.threads = threads;
+			var.config.tile = tile;
+			var.name = "fused " + std::to_string(threads) + " threads tile " + std::to_string(tile);
+			out.emplace_back(var);
+		}
+	}
+	return out;
+}
+
+/*
+@brief: Solves a case with the reference, slice by slice if requested.
+*/
+auto SolveReference(const TestCase& testCase)
+{
+	auto size_ = testCase.size;
+	auto spacing = testCase.spacing;
+	size_t cnt = 1;
+	if (testCase.sliceBySlice)
+	{
+		cnt = size_[2];
+		size_.resize(2);
+		spacing.resize(2);
+	}
+	const auto scaling = testCase.isIso ? std::vector<float>() : TVengine::computeScaling(spacing);
+	const auto sz = size_[0] * size_[1];
+	std::vector<double> out;
+	TVreference reference;
+	for (size_t ind = 0; ind < cnt; ++ind)
+	{
+		const std::vector<double> in(std::begin(testCase.in) + ind * sz, std::begin(testCase.in) + (testCase.sliceBySlice ? (ind + 1) * sz : std::size(testCase.in)));
+		const auto res = reference.solve(in, size_, scaling, testCase.lambda + TVengine::EPSILON, 0.15 + TVengine::EPSILON, testCase.it);
+		out.insert(std::end(out), std::begin(res), std::end(res));
+	}
+	return out;
+}
+
+/*
+@brief: Solves a case with the engine in the given configuration.
+*/
+template<typename TOut>
+auto SolveEngine(const TestCase& testCase, const TVconfig& config)
+{
+	auto size_ = testCase.size;
+	auto spacing = testCase.spacing;
+	size_t cnt = 1;
+	if (testCase.sliceBySlice)
+	{
+		cnt = size_[2];
+		size_.resize(2);
+		spacing.resize(2);
+	}
+	TVengine engine;
+	engine.setLambda(testCase.lambda);
+	engine.setIt(testCase.it);
+	engine.setConfig(config);
+	const auto scaling = TVengine::computeScaling(spacing);
+	std::vector<TOut> out(std::size(testCase.in));
+	if (testCase.isIso)
+		engine.runBatch<true>(std::data(testCase.in), std::data(out), size_, scaling, cnt);
+	else
+		engine.runBatch<false>(std::data(testCase.in), std::data(out), size_, scaling, cnt);
+	return out;
+}
+
+std::string Describe(const TestCase& testCase)
+{
+	std::string out = "size";
+	for (auto item : testCase.size)
+		out += " " + std::to_string(item);
+	out += testCase.isIso ? ", isotropic" : ", anisotropic";
+	out += testCase.sliceBySlice ? ", slice by slice" : "";
+	out += ", it " + std::to_string(testCase.it);
+	return out;
+}
+
+TEST(TVengine, VariantsMatchReference)
+{
+	std::mt19937 gen(20181229u);
+	const auto variants = GetVariants();
+	for (auto ind = 0u; ind < CASE_NUM; ++ind)
+	{
+		const auto testCase = GetCase(gen);
+		const auto ref = SolveReference(testCase);
+		double scale = 0.0;
+		for (auto item : ref)
+			scale = std::max(scale, std::abs(item));
+		for (const auto& variant : variants)
+		{
+			const auto out = SolveEngine<float>(testCase, variant.config);
+			double err = 0.0;
+			for (size_t pos = 0; pos < std::size(ref); ++pos)
+				err = std::max(err, std::abs(out[pos] - ref[pos]));
+			EXPECT_LE(err, TOLERANCE * (1.0 + scale)) << variant.name << ", " << Describe(testCase);
+		}
+	}
+}
+
+TEST(TVengine, VariantsAgree)
+{
+	std::mt19937 gen(31u);
+	const auto variants = GetVariants();
+	for (auto ind = 0u; ind < CASE_NUM; ++ind)
+	{
+		const auto testCase = GetCase(gen);
+		const auto first = SolveEngine<float>(testCase, variants[0].config);
+		double scale = 0.0;
+		for (auto item : first)
+			scale = std::max(scale, static_cast<double>(std::abs(item)));
+		for (const auto& variant : variants)
+		{
+			const auto out = SolveEngine<float>(testCase, variant.config);
+			for (size_t pos = 0; pos < std::size(out); ++pos)
+			{
+				ASSERT_NEAR(out[pos], first[pos], VARIANT_TOLERANCE * (1.0 + scale)) << variant.name << ", " << Describe(testCase);
+			}
+		}
+	}
+}
+
+TEST(TVengine, IntegerOutput)
+{
+	std::mt19937 gen(7u);
+	for (auto ind = 0u; ind < CASE_NUM / 4; ++ind)
+	{
+		auto testCase = GetCase(gen);
+		for (auto& item : testCase.in)
+			item = std::round(item);
+		const auto ref = SolveReference(testCase);
+		TVconfig config;
+		config.kernel = TVkernel::FUSED;
+		const auto out = SolveEngine<unsigned char>(testCase, config);
+		for (size_t pos = 0; pos < std::size(ref); ++pos)
+		{
+			const double expected = std::round(std::min(std::max(ref[pos], 0.0), 255.0));
+			ASSERT_NEAR(out[pos], expected, 1.0) << Describe(testCase);
+		}
+	}
+}
+
+TEST(TVparallel, RethrowsOperationException)
+{
+	std::atomic<size_t> done{ 0 };
+	const auto operation = [&](const size_t begin, const size_t end)
+	{
+		if (begin <= 50 && 50 < end)
+			throw std::runtime_error("block failed");
+		done += end - begin;
+	};
+	EXPECT_THROW(parallelFor(1000, 10, 4, operation), std::runtime_error);
+	EXPECT_LT(done.load(), size_t(1000));
+}
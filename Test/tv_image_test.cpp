@@ -57,4 +57,15 @@ TEST(TVimage, Divergence)
 }
 
 
+TEST(TVimage, Construction)
+{
+	TVimage<> fromArgs(11, 12, 13);
+	TVimage<> fromVector(std::vector<unsigned int>{ 11, 12, 13 });
+
+	EXPECT_EQ(fromArgs.getDim(), 3u);
+	EXPECT_EQ(fromArgs.getSize(), fromVector.getSize());
+	EXPECT_EQ(std::size(fromArgs), 11u * 12u * 13u);
+}
+
+
 //Test for operators should be added.
\ No newline at end of file
@@ -0,0 +1,109 @@
+
+#include "tv_mpi_engine.h"
+#include "gtest/gtest.h"
+#include <mpi.h>
+#include <vector>
+
+
+int main(int argc, char **argv) {
+	MPI_Init(&argc, &argv);
+	::testing::InitGoogleTest(&argc, argv);
+	const auto ret = RUN_ALL_TESTS();
+	MPI_Finalize();
+	return ret;
+}
+
+/*Same noisy phantom on every rank*/
+template<typename T>
+auto GetPhantom(const std::vector<size_t> imSize)
+{
+	size_t sz = 1;
+	for (auto item : imSize)
+		sz *= item;
+	std::vector<T> out(sz);
+	unsigned int seed = 12345u;
+	for (size_t ind = 0; ind < sz; ++ind)
+	{
+		seed = seed * 1103515245u + 12345u;
+		const float noise = static_cast<float>((seed >> 16) % 64);
+		out[ind] = static_cast<T>(((ind / 7) % 3 ? 100.f : 20.f) + noise);
+	}
+	return out;
+}
+
+template<bool IsIso, typename T>
+void CompareWithSingleProcess(const std::vector<size_t> imSize, const std::vector<float> spacing)
+{
+	int rank, nRanks;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &nRanks);
+
+	TVengine engine;
+	engine.setIt(15);
+	engine.setLambda(20.f);
+	const auto scaling = TVengine::computeScaling(spacing);
+	const auto in = GetPhantom<T>(imSize);
+
+	std::vector<T> ref(std::size(in));
+	TVimage<IsIso> im(imSize);
+	im.setScaling(scaling);
+	engine.run(std::data(in), im, std::data(ref));
+	/*Slabs run the fused kernel, so they reproduce its single process result exactly*/
+	auto fusedEngine = engine;
+	TVconfig config;
+	config.kernel = TVkernel::FUSED;
+	fusedEngine.setConfig(config);
+	std::vector<T> fused(std::size(in));
+	fusedEngine.run(std::data(in), im, std::data(fused));
+
+	const auto zAxis = std::size(imSize) - 1;
+	const auto plane = im.getStride()[zAxis];
+	const auto slab = getSlab(imSize[zAxis], rank, nRanks);
+	auto localSize = imSize;
+	localSize[zAxis] = slab.count + 2;
+	TVimage<IsIso> local(localSize);
+	local.setScaling(scaling);
+	std::vector<T> out(slab.count * plane);
+	TVmpiEngine mpiEngine(engine);
+	mpiEngine.run(std::data(in) + slab.begin * plane, local, std::data(out));
+
+	for (size_t ind = 0; ind < std::size(out); ++ind)
+	{
+		ASSERT_NEAR(out[ind], ref[slab.begin * plane + ind], 1e-3f);
+		ASSERT_EQ(out[ind], fused[slab.begin * plane + ind]);
+	}
+	EXPECT_GT(mpiEngine.getResidual(), 0.0);
+}
+
+TEST(TVmpiEngine, Isotropic3D)
+{
+	CompareWithSingleProcess<true, float>({ 13, 11, 17 }, { 1.f, 1.f, 1.f });
+}
+
+TEST(TVmpiEngine, Anisotropic3D)
+{
+	CompareWithSingleProcess<false, float>({ 13, 11, 17 }, { 0.5f, 0.7f, 2.5f });
+}
+
+TEST(TVmpiEngine, Anisotropic2D)
+{
+	CompareWithSingleProcess<false, float>({ 21, 19 }, { 0.8f, 1.6f });
+}
+
+TEST(TVmpiEngine, UnsignedShort3D)
+{
+	CompareWithSingleProcess<false, unsigned short>({ 9, 10, 12 }, { 1.f, 1.f, 3.f });
+}
+
+TEST(TVslab, CoversAxis)
+{
+	const size_t length = 17;
+	size_t next = 0;
+	for (int rank = 0; rank < 5; ++rank)
+	{
+		const auto slab = getSlab(length, rank, 5);
+		EXPECT_EQ(slab.begin, next);
+		next += slab.count;
+	}
+	EXPECT_EQ(next, length);
+}
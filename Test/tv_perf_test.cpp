@@ -0,0 +1,138 @@
+
+#include "tv_engine.h"
+#include "gtest/gtest.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+int main(int argc, char **argv) {
+	::testing::InitGoogleTest(&argc, argv);
+	return RUN_ALL_TESTS();
+}
+
+/*
+Baseline file holds "<variant> <voxel iterations per second>" lines. TVMIN_PERF_BASELINE
+overrides its location, TVMIN_PERF_UPDATE=1 rewrites it with the measured values and
+TVMIN_PERF_TOLERANCE sets the allowed relative slowdown. Variants missing from the
+baseline are only reported.
+*/
+#ifndef TVMIN_PERF_BASELINE_FILE
+#define TVMIN_PERF_BASELINE_FILE "perf_baseline.txt"
+#endif
+
+constexpr unsigned int REPEAT_NUM = 9;
+constexpr unsigned int IT_NUM = 10;
+constexpr double DEFAULT_TOLERANCE = 0.5;
+
+std::string GetBaselinePath()
+{
+	const char* path = std::getenv("TVMIN_PERF_BASELINE");
+	return path ? path : TVMIN_PERF_BASELINE_FILE;
+}
+
+auto ReadBaseline()
+{
+	std::map<std::string, double> out;
+	std::ifstream file(GetBaselinePath());
+	std::string line;
+	while (std::getline(file, line))
+	{
+		if (std::empty(line) || '#' == line[0])
+			continue;
+		std::istringstream stream(line);
+		std::string name;
+		double value;
+		if (stream >> name >> value)
+			out[name] = value;
+	}
+	return out;
+}
+
+void WriteBaseline(const std::map<std::string, double>& baseline)
+{
+	std::ofstream file(GetBaselinePath(), std::ios::trunc);
+	file << "# <variant> <voxel iterations per second>, see tv_perf_test.cpp\n";
+	for (const auto& item : baseline)
+		file << item.first << " " << item.second << "\n";
+}
+
+/*
+@brief: Measures the best throughput of a configuration on a synthetic phantom.
+@return: Voxel iterations per second.
+*/
+template<bool IsIso>
+double Measure(const TVconfig& config, const std::vector<size_t>& size_, const size_t cnt)
+{
+	size_t sz = cnt;
+	for (auto item : size_)
+		sz *= item;
+	std::vector<float> in(sz);
+	for (size_t ind = 0; ind < sz; ++ind)
+		in[ind] = ((ind / 11) % 2 ? 200.f : 50.f) + static_cast<float>((ind * 7919) % 37);
+	std::vector<float> out(sz);
+
+	TVengine engine;
+	engine.setLambda(20.f);
+	engine.setIt(IT_NUM);
+	engine.setConfig(config);
+	std::vector<float> spacing(std::size(size_), 1.f);
+	spacing.back() = 2.5f;
+	const auto scaling = TVengine::computeScaling(spacing);
+
+	double best = 0.0;
+	for (auto ind = 0u; ind < REPEAT_NUM; ++ind)
+	{
+		const auto start = std::chrono::steady_clock::now();
+		engine.runBatch<IsIso>(std::data(in), std::data(out), size_, scaling, cnt);
+		const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+		best = std::max(best, static_cast<double>(sz) * IT_NUM / elapsed.count());
+	}
+	return best;
+}
+
+TEST(TVperformance, Throughput)
+{
+#ifndef TVMIN_PERF_OPTIMIZED
+	GTEST_SKIP() << "Throughput is only checked in optimized builds";
+#endif
+	const char* tol = std::getenv("TVMIN_PERF_TOLERANCE");
+	const double tolerance = tol ? std::atof(tol) : DEFAULT_TOLERANCE;
+	const char* update = std::getenv("TVMIN_PERF_UPDATE");
+	const bool isUpdate = update && '1' == update[0];
+	const auto nThreads = std::thread::hardware_concurrency();
+
+	TVconfig operatorConfig;
+	TVconfig fusedConfig;
+	fusedConfig.kernel = TVkernel::FUSED;
+	TVconfig threadedConfig = fusedConfig;
+	threadedConfig.threads = nThreads;
+	threadedConfig.tile = 2;
+
+	std::map<std::string, double> measured;
+	measured["operator_3d"] = Measure<false>(operatorConfig, { 64, 64, 64 }, 1);
+	measured["fused_3d"] = Measure<false>(fusedConfig, { 64, 64, 64 }, 1);
+	measured["fused_threads_3d"] = Measure<false>(threadedConfig, { 64, 64, 64 }, 1);
+	measured["fused_slices_2d"] = Measure<true>(threadedConfig, { 128, 128 }, 16);
+
+	auto baseline = ReadBaseline();
+	for (const auto& item : measured)
+	{
+		std::cout << item.first << ": " << item.second << " voxel iterations/s\n";
+		const auto found = baseline.find(item.first);
+		if (isUpdate || std::end(baseline) == found)
+		{
+			baseline[item.first] = item.second;
+			continue;
+		}
+		EXPECT_GE(item.second, (1.0 - tolerance) * found->second) << item.first << " is slower than the baseline";
+	}
+	if (isUpdate)
+		WriteBaseline(baseline);
+}
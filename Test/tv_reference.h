@@ -0,0 +1,117 @@
+
+#ifndef __TV_REFERENCE__
+#define __TV_REFERENCE__
+
+#include <cmath>
+#include <vector>
+
+/*
+Straightforward implementation of the Chambolle iteration used as the reference of the
+engine variants. Pixels are addressed through their multi index and computed in double,
+nothing is shared with TVimage or TVengine. It follows the engine conventions: forward
+differences vanish on the last pixel of an axis, backward ones on the first pixel, and
+the normalization term r is carried over between iterations.
+*/
+class TVreference
+{
+public:
+	/*
+	@brief: Solves the problem.
+	@param: in Input pixels.
+	@param: size Size of the image.
+	@param: scaling Scaling of the derivatives, empty for isotropic processing.
+	@param: lambda Lambda value.
+	@param: to To value.
+	@param: it Iteration number.
+	@return: Output pixels.
+	*/
+	std::vector<double> solve(const std::vector<double>& in, const std::vector<size_t>& size, const std::vector<float>& scaling, const double lambda, const double to, const unsigned int it)
+	{
+		m_size = size;
+		m_stride.assign(1, 1);
+		for (auto item : size)
+			m_stride.emplace_back(m_stride.back() * item);
+		m_scale.assign(std::size(size), 1.0);
+		for (size_t d = 0; d < std::size(scaling); ++d)
+			m_scale[d] = scaling[d];
+
+		const auto n = std::size(in);
+		const auto dm = std::size(size);
+		std::vector<double> u(n);
+		for (size_t i = 0; i < n; ++i)
+			u[i] = in[i] / lambda;
+
+		std::vector<std::vector<double>> p(dm, std::vector<double>(n));
+		for (size_t d = 0; d < dm; ++d)
+			for (size_t i = 0; i < n; ++i)
+				p[d][i] = forward(u, i, d);
+
+		std::vector<double> g(n);
+		std::vector<double> r(n);
+		auto updateG = [&]()
+		{
+			for (size_t i = 0; i < n; ++i)
+				g[i] = divergence(p, i) - u[i];
+		};
+		updateG();
+		for (size_t i = 0; i < n; ++i)
+			r[i] = forward(g, i, 0) * forward(g, i, 0);
+
+		for (auto k = 1u; k < it; ++k)
+		{
+			updateG();
+			for (size_t i = 0; i < n; ++i)
+			{
+				std::vector<double> psi(dm);
+				double norm = r[i];
+				for (size_t d = 0; d < dm; ++d)
+				{
+					psi[d] = forward(g, i, d);
+					norm += psi[d] * psi[d];
+				}
+				r[i] = 1.0 + to * std::sqrt(norm);
+				for (size_t d = 0; d < dm; ++d)
+					p[d][i] = (p[d][i] + to * psi[d]) / r[i];
+			}
+		}
+
+		std::vector<double> out(n);
+		for (size_t i = 0; i < n; ++i)
+			out[i] = lambda * (u[i] - divergence(p, i));
+		return out;
+	}
+
+private:
+	size_t coordinate(const size_t i, const size_t d) const
+	{
+		return (i / m_stride[d]) % m_size[d];
+	}
+
+	double forward(const std::vector<double>& v, const size_t i, const size_t d) const
+	{
+		if (coordinate(i, d) + 1 == m_size[d])
+			return 0.0;
+		return m_scale[d] * (v[i + m_stride[d]] - v[i]);
+	}
+
+	double backward(const std::vector<double>& v, const size_t i, const size_t d) const
+	{
+		if (0 == coordinate(i, d))
+			return 0.0;
+		return m_scale[d] * (v[i] - v[i - m_stride[d]]);
+	}
+
+	double divergence(const std::vector<std::vector<double>>& p, const size_t i) const
+	{
+		double out = 0.0;
+		for (size_t d = 0; d < std::size(p); ++d)
+			out += backward(p[d], i, d);
+		return out;
+	}
+
+	std::vector<size_t> m_size;
+	std::vector<size_t> m_stride;
+	std::vector<double> m_scale;
+};
+
+#endif
@@ -0,0 +1,133 @@
+/*
+ * Project: 3D Total Variation minimization
+ * Author: Gokhan Gunay, ghngunay@gmail.com
+ * Copyright: (C) 2018 by Gokhan Gunay
+ * License: GNU GPL v3 (see License.txt)
+ */
+
+#include "tvmin.h"
+
+#include "tv_autotune.h"
+#include "tv_engine.h"
+
+#include <new>
+#include <vector>
+
+namespace
+{
+
+template<bool IsIso, typename T>
+void solve(const T* in, T* out, const std::vector<size_t>& size_, const std::vector<float>& spacing, const size_t cnt, TVengine& engine, const bool autoTune)
+{
+	const auto scaling = TVengine::computeScaling(spacing);
+	if (autoTune && in != out)
+	{
+		engine.setConfig(TVautotune::getConfig<IsIso>(engine, in, out, size_, scaling, cnt));
+	}
+	else if (autoTune)
+	{
+		/*Trials write their results, so an in place call needs a scratch buffer for them*/
+		const auto key = TVautotune::getKey(size_, cnt, IsIso);
+		TVconfig config;
+		if (!TVautotune::load(key, config))
+		{
+			size_t sz = cnt;
+			for (auto item : size_)
+				sz *= item;
+			std::vector<T> scratch(sz);
+			config = TVautotune::tune<IsIso>(engine, in, std::data(scratch), size_, scaling, cnt);
+			TVautotune::store(key, config);
+		}
+		engine.setConfig(config);
+	}
+	engine.template runBatch<IsIso>(in, out, size_, scaling, cnt);
+}
+
+}
+
+void tvmin_default_params(tvmin_params* params)
+{
+	if (!params)
+		return;
+	params->lambda = 0.f;
+	params->to = 0.15f;
+	params->iterations = 10;
+	params->use_spacing = 0;
+	params->slice_by_slice = 0;
+	params->fused = 0;
+	params->threads = 1;
+	params->tile = 1;
+	params->auto_tune = 0;
+}
+
+tvmin_status tvmin_solve_f32(const float* in, float* out, unsigned int dim, const size_t* size, const float* spacing, const tvmin_params* params)
+{
+	tvmin_params par;
+	tvmin_default_params(&par);
+	if (params)
+		par = *params;
+
+	if (!in || !out || 0 == dim || !size || (par.use_spacing && !spacing) || 0 == par.iterations)
+		return TVMIN_INVALID_ARGUMENT;
+	for (auto ind = 0u; ind < dim; ++ind)
+	{
+		if (0 == size[ind])
+			return TVMIN_INVALID_ARGUMENT;
+	}
+
+	try
+	{
+		std::vector<size_t> size_(size, size + dim);
+		std::vector<float> spacing_(dim, 1.f);
+		if (spacing)
+			spacing_.assign(spacing, spacing + dim);
+
+		size_t cnt = 1;
+		if (par.slice_by_slice && dim > 2)
+		{
+			for (auto ind = 2u; ind < dim; ++ind)
+				cnt *= size_[ind];
+			spacing_.resize(2);
+			size_.resize(2);
+		}
+
+		TVengine engine;
+		engine.setLambda(par.lambda);
+		engine.setTo(par.to);
+		engine.setIt(par.iterations);
+		TVconfig config;
+		config.kernel = par.fused ? TVkernel::FUSED : TVkernel::OPERATOR;
+		config.threads = std::max(1u, par.threads);
+		config.tile = std::max(1u, par.tile);
+		engine.setConfig(config);
+
+		if (par.use_spacing)
+			solve<false>(in, out, size_, spacing_, cnt, engine, 0 != par.auto_tune);
+		else
+			solve<true>(in, out, size_, spacing_, cnt, engine, 0 != par.auto_tune);
+	}
+	catch (const std::bad_alloc&)
+	{
+		return TVMIN_OUT_OF_MEMORY;
+	}
+	catch (...)
+	{
+		return TVMIN_ERROR;
+	}
+	return TVMIN_OK;
+}
+
+const char* tvmin_status_string(tvmin_status status)
+{
+	switch (status)
+	{
+	case TVMIN_OK:
+		return "success";
+	case TVMIN_INVALID_ARGUMENT:
+		return "invalid argument";
+	case TVMIN_OUT_OF_MEMORY:
+		return "out of memory";
+	default:
+		return "internal error";
+	}
+}
@@ -0,0 +1,93 @@
+/*
+ * Project: 3D Total Variation minimization
+ * Author: Gokhan Gunay, ghngunay@gmail.com
+ * Copyright: (C) 2018 by Gokhan Gunay
+ * License: GNU GPL v3 (see License.txt)
+ */
+
+#ifndef __TVMIN_H__
+#define __TVMIN_H__
+
+#include <stddef.h>
+
+#if defined(_WIN32)
+#if defined(TVMIN_EXPORTS)
+#define TVMIN_API __declspec(dllexport)
+#else
+#define TVMIN_API __declspec(dllimport)
+#endif
+#else
+#define TVMIN_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum tvmin_status
+{
+	TVMIN_OK = 0,
+	TVMIN_INVALID_ARGUMENT,
+	TVMIN_OUT_OF_MEMORY,
+	TVMIN_ERROR
+} tvmin_status;
+
+typedef struct tvmin_params
+{
+	/*Regularization weight of the cost function*/
+	float lambda;
+	/*Step size of the dual iteration*/
+	float to;
+	/*Number of iterations, at least 1*/
+	unsigned int iterations;
+	/*Weights directional derivatives by the pixel spacing if nonzero*/
+	int use_spacing;
+	/*Processes a 3D or higher dimensional image slice by slice if nonzero*/
+	int slice_by_slice;
+	/*Uses the fused kernel if nonzero, the result does not change*/
+	int fused;
+	/*Number of threads*/
+	unsigned int threads;
+	/*Planes of the last axis handed to a thread at once by the fused kernel*/
+	unsigned int tile;
+	/*
+	Chooses kernel, threads and tile by timing trial solves if nonzero, see tv_autotune.h.
+	Trials write their results, so an in place call allocates a full image sized scratch
+	buffer for them unless the choice is already cached.
+	*/
+	int auto_tune;
+} tvmin_params;
+
+/*
+@brief: Fills parameters with the defaults of the TV_MIN_FILTER executable.
+@param: params Parameters to be filled.
+@return:
+*/
+TVMIN_API void tvmin_default_params(tvmin_params* params);
+
+/*
+@brief: Denoises an image held in caller owned memory. The pixels are contiguous with
+the first axis varying fastest. Only the working set of the solver is allocated, plus
+a scratch image for in place calls with auto_tune (see tvmin_params).
+@param: in Input pixels.
+@param: out Output pixels, may be the same buffer as in.
+@param: dim Number of the image dimensions.
+@param: size Size of the image, dim elements.
+@param: spacing Pixel spacing, dim elements. May be NULL if use_spacing is zero.
+@param: params Parameters of the algorithm. Defaults are used if NULL.
+@return: Status of the call.
+*/
+TVMIN_API tvmin_status tvmin_solve_f32(const float* in, float* out, unsigned int dim, const size_t* size, const float* spacing, const tvmin_params* params);
+
+/*
+@brief: Gets a description of a status.
+@param: status Status of a call.
+@return: Null terminated static string.
+*/
+TVMIN_API const char* tvmin_status_string(tvmin_status status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
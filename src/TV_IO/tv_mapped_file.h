@@ -0,0 +1,176 @@
+/*
+ * Project: 3D Total Variation minimization
+ * Author: Gokhan Gunay, ghngunay@gmail.com
+ * Copyright: (C) 2018 by Gokhan Gunay
+ * License: GNU GPL v3 (see License.txt)
+ */
+
+#ifndef __TV_MAPPED_FILE__
+#define __TV_MAPPED_FILE__
+
+#include <cstddef>
+#include <string>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*
+Memory mapping of a whole file. A writable mapping creates the file if needed and sets
+its size, the pages are written back by the operating system.
+*/
+class TVmappedFile
+{
+public:
+	TVmappedFile() = default;
+	TVmappedFile(const TVmappedFile&) = delete;
+	TVmappedFile& operator=(const TVmappedFile&) = delete;
+
+	~TVmappedFile()
+	{
+		close();
+	}
+
+	/*
+	@brief: Maps a file for reading.
+	@param: fileName Name of the file.
+	@return: True on success.
+	*/
+	bool openRead(const std::string& fileName)
+	{
+		close();
+#if defined(_WIN32)
+		m_file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		LARGE_INTEGER sz;
+		if (INVALID_HANDLE_VALUE == m_file || !GetFileSizeEx(m_file, &sz))
+			return false;
+		m_size = static_cast<size_t>(sz.QuadPart);
+		return map(false);
+#else
+		m_fd = ::open(fileName.c_str(), O_RDONLY);
+		struct stat st;
+		if (m_fd < 0 || 0 != fstat(m_fd, &st))
+			return false;
+		m_size = static_cast<size_t>(st.st_size);
+		return map(false);
+#endif
+	}
+
+	/*
+	@brief: Maps a file for writing. Its size is set to the given one, data before that
+	point, e.g. a header, is kept.
+	@param: fileName Name of the file.
+	@param: size Size of the file in bytes.
+	@return: True on success.
+	*/
+	bool openWrite(const std::string& fileName, const size_t size)
+	{
+		close();
+		m_size = size;
+#if defined(_WIN32)
+		m_file = CreateFileA(fileName.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		LARGE_INTEGER sz;
+		sz.QuadPart = static_cast<LONGLONG>(size);
+		if (INVALID_HANDLE_VALUE == m_file || !SetFilePointerEx(m_file, sz, nullptr, FILE_BEGIN) || !SetEndOfFile(m_file))
+			return false;
+		return map(true);
+#else
+		m_fd = ::open(fileName.c_str(), O_RDWR | O_CREAT, 0644);
+		if (m_fd < 0 || 0 != ftruncate(m_fd, static_cast<off_t>(size)))
+			return false;
+		return map(true);
+#endif
+	}
+
+	/*
+	@brief: Tells the operating system that the mapping will be accessed sequentially.
+	@return:
+	*/
+	void adviseSequential()
+	{
+#if !defined(_WIN32)
+		if (m_data)
+			madvise(m_data, m_size, MADV_SEQUENTIAL);
+#endif
+	}
+
+	/*
+	@brief: Writes the modified pages back and unmaps the file.
+	@return: True if the pages could be written.
+	*/
+	bool close()
+	{
+		bool ok = true;
+#if defined(_WIN32)
+		if (m_data)
+		{
+			ok = m_writable ? (FlushViewOfFile(m_data, 0) && FlushFileBuffers(m_file)) : true;
+			UnmapViewOfFile(m_data);
+		}
+		if (m_mapping)
+			CloseHandle(m_mapping);
+		if (INVALID_HANDLE_VALUE != m_file)
+			CloseHandle(m_file);
+		m_mapping = nullptr;
+		m_file = INVALID_HANDLE_VALUE;
+#else
+		if (m_data)
+		{
+			ok = m_writable ? 0 == msync(m_data, m_size, MS_SYNC) : true;
+			munmap(m_data, m_size);
+		}
+		if (m_fd >= 0)
+			::close(m_fd);
+		m_fd = -1;
+#endif
+		m_data = nullptr;
+		m_size = 0;
+		return ok;
+	}
+
+	char* data() const noexcept
+	{
+		return static_cast<char*>(m_data);
+	}
+
+	size_t size() const noexcept
+	{
+		return m_size;
+	}
+
+private:
+	bool map(const bool writable)
+	{
+		m_writable = writable;
+		if (0 == m_size)
+			return false;
+#if defined(_WIN32)
+		m_mapping = CreateFileMappingA(m_file, nullptr, writable ? PAGE_READWRITE : PAGE_READONLY, 0, 0, nullptr);
+		if (!m_mapping)
+			return false;
+		m_data = MapViewOfFile(m_mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0);
+#else
+		m_data = mmap(nullptr, m_size, writable ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, m_fd, 0);
+		if (MAP_FAILED == m_data)
+			m_data = nullptr;
+#endif
+		return nullptr != m_data;
+	}
+
+	void* m_data = nullptr;
+	size_t m_size = 0;
+	bool m_writable = false;
+#if defined(_WIN32)
+	HANDLE m_file = INVALID_HANDLE_VALUE;
+	HANDLE m_mapping = nullptr;
+#else
+	int m_fd = -1;
+#endif
+};
+
+#endif
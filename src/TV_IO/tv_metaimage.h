@@ -0,0 +1,320 @@
+/*
+ * Project: 3D Total Variation minimization
+ * Author: Gokhan Gunay, ghngunay@gmail.com
+ * Copyright: (C) 2018 by Gokhan Gunay
+ * License: GNU GPL v3 (see License.txt)
+ */
+
+#ifndef __TV_METAIMAGE__
+#define __TV_METAIMAGE__
+
+#include <cstddef>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/*
+Minimal reader and writer of uncompressed MetaImage (.mha/.mhd) headers. Only the
+information needed to address the raw voxel data directly and the geometry of the
+image are handled.
+*/
+struct MetaImageHeader
+{
+	std::vector<size_t> size;
+	std::vector<float> spacing;
+	/*Origin, empty if the header has none*/
+	std::vector<double> offset;
+	/*Direction cosines as in TransformMatrix, those of an axis are consecutive. Empty if the header has none*/
+	std::vector<double> direction;
+	std::string elementType = "MET_FLOAT";
+	/*Path of the file holding the voxels*/
+	std::string dataFile;
+	/*Byte offset of the first voxel in the data file*/
+	size_t dataOffset = 0;
+	bool compressed = false;
+	bool msb = false;
+	/*Components of a voxel*/
+	size_t channels = 1;
+	/*HeaderSize field: absolute offset of the voxels if positive, -1 if they end the file*/
+	long long headerSize = 0;
+
+	/*
+	@brief: Gets number of the voxels.
+	@return: Voxel count.
+	*/
+	size_t getCount() const
+	{
+		size_t cnt = std::empty(size) ? 0 : 1;
+		for (auto item : size)
+			cnt *= item;
+		return cnt;
+	}
+
+	/*
+	@brief: Gets size of a voxel in bytes.
+	@return: Size of the element type, 0 if the type is not supported.
+	*/
+	size_t getElementSize() const
+	{
+		if ("MET_UCHAR" == elementType)
+			return 1;
+		if ("MET_SHORT" == elementType || "MET_USHORT" == elementType)
+			return 2;
+		if ("MET_FLOAT" == elementType)
+			return 4;
+		return 0;
+	}
+
+	/*
+	@brief: Checks if the voxels can be addressed directly in the data file.
+	@return: True if the data is uncompressed, little endian, scalar and of a supported type.
+	*/
+	bool isRaw() const
+	{
+		return !compressed && !msb && 1 == channels && 0 != getElementSize() && !std::empty(dataFile);
+	}
+};
+
+/*
+@brief: Gets the directory part of a path including the trailing separator.
+@param: path File path.
+@return: Directory of the file.
+*/
+inline std::string getDirectory(const std::string& path)
+{
+	const auto pos = path.find_last_of("/\\");
+	return std::string::npos == pos ? std::string() : path.substr(0, pos + 1);
+}
+
+/*
+@brief: Gets the file name part of a path.
+@param: path File path.
+@return: Name of the file.
+*/
+inline std::string getFileName(const std::string& path)
+{
+	const auto pos = path.find_last_of("/\\");
+	return std::string::npos == pos ? path : path.substr(pos + 1);
+}
+
+/*
+@brief: Checks if a file name has a MetaImage extension.
+@param: fileName Name of the file.
+@return: True for .mha and .mhd files.
+*/
+inline bool isMetaImageFile(const std::string& fileName)
+{
+	const auto ext = fileName.size() > 4 ? fileName.substr(fileName.size() - 4) : std::string();
+	return ".mha" == ext || ".mhd" == ext;
+}
+
+/*
+@brief: Reads header of a MetaImage file.
+@param: fileName Name of the .mha or .mhd file.
+@param: header Header to be filled.
+@return: True on success.
+*/
+inline bool readMetaImageHeader(const std::string& fileName, MetaImageHeader& header)
+{
+	if (!isMetaImageFile(fileName))
+		return false;
+	std::ifstream file(fileName, std::ios::binary);
+	if (!file)
+		return false;
+
+	header = MetaImageHeader();
+	std::string line;
+	while (std::getline(file, line))
+	{
+		const auto pos = line.find('=');
+		/*A header consists of key = value lines only, anything else is not a MetaImage*/
+		if (std::string::npos == pos)
+		{
+			if (std::string::npos == line.find_first_not_of(" \t\r"))
+				continue;
+			return false;
+		}
+		auto trim = [](std::string in)
+		{
+			const auto first = in.find_first_not_of(" \t\r");
+			const auto last = in.find_last_not_of(" \t\r");
+			return std::string::npos == first ? std::string() : in.substr(first, last - first + 1);
+		};
+		const auto key = trim(line.substr(0, pos));
+		const auto value = trim(line.substr(pos + 1));
+		std::istringstream stream(value);
+
+		if ("DimSize" == key)
+		{
+			size_t item;
+			while (stream >> item)
+				header.size.emplace_back(item);
+		}
+		else if ("ElementSpacing" == key || ("ElementSize" == key && std::empty(header.spacing)))
+		{
+			header.spacing.clear();
+			float item;
+			while (stream >> item)
+				header.spacing.emplace_back(item);
+		}
+		else if ("Offset" == key || "Origin" == key || "Position" == key)
+		{
+			header.offset.clear();
+			double item;
+			while (stream >> item)
+				header.offset.emplace_back(item);
+		}
+		else if ("TransformMatrix" == key || "Rotation" == key || "Orientation" == key)
+		{
+			header.direction.clear();
+			double item;
+			while (stream >> item)
+				header.direction.emplace_back(item);
+		}
+		else if ("ElementType" == key)
+		{
+			header.elementType = value;
+		}
+		else if ("CompressedData" == key)
+		{
+			header.compressed = ("True" == value || "true" == value);
+		}
+		else if ("BinaryDataByteOrderMSB" == key || "ElementByteOrderMSB" == key)
+		{
+			header.msb = ("True" == value || "true" == value);
+		}
+		else if ("ElementNumberOfChannels" == key)
+		{
+			stream >> header.channels;
+		}
+		else if ("HeaderSize" == key)
+		{
+			stream >> header.headerSize;
+		}
+		else if ("ElementDataFile" == key)
+		{
+			/*ElementDataFile is always the last field of the header*/
+			if ("LOCAL" == value)
+			{
+				header.dataFile = fileName;
+				header.dataOffset = static_cast<size_t>(file.tellg());
+			}
+			else if (!std::empty(value) && '/' != value[0] && '\\' != value[0] && std::string::npos == value.find(':'))
+			{
+				header.dataFile = getDirectory(fileName) + value;
+			}
+			else
+			{
+				header.dataFile = value;
+			}
+			break;
+		}
+	}
+	if (header.headerSize > 0)
+	{
+		header.dataOffset = static_cast<size_t>(header.headerSize);
+	}
+	else if (-1 == header.headerSize)
+	{
+		/*Voxels are at the end of the data file*/
+		std::ifstream data(header.dataFile, std::ios::binary | std::ios::ate);
+		const auto bytes = header.getCount() * header.channels * header.getElementSize();
+		const auto end = static_cast<long long>(data.tellg());
+		if (!data || end < static_cast<long long>(bytes))
+			return false;
+		header.dataOffset = static_cast<size_t>(end) - bytes;
+	}
+	if (std::empty(header.spacing))
+		header.spacing.resize(std::size(header.size), 1.f);
+	return !std::empty(header.size) && std::size(header.size) == std::size(header.spacing);
+}
+
+/*Alignment of the voxels following a written header*/
+constexpr size_t DATA_ALIGNMENT = 64;
+
+/*
+@brief: Formats header of a MetaImage file. If the file name has .mhd extension the
+voxels are expected in a .raw file next to it, otherwise they follow the header, which
+is padded so that they start at a multiple of DATA_ALIGNMENT bytes.
+@param: fileName Name of the .mha or .mhd file.
+@param: header Header to be formatted. Its data file and offset are updated.
+@return: Header text.
+*/
+inline std::string formatMetaImageHeader(const std::string& fileName, MetaImageHeader& header)
+{
+	const bool detached = fileName.size() > 4 && ".mhd" == fileName.substr(fileName.size() - 4);
+	std::ostringstream stream;
+	stream << "ObjectType = Image\n";
+	stream << "NDims = " << std::size(header.size) << "\n";
+	stream << "BinaryData = True\n";
+	stream << "BinaryDataByteOrderMSB = False\n";
+	stream << "CompressedData = False\n";
+	/*Geometry is written with enough digits to be read back unchanged*/
+	const auto precision = stream.precision(std::numeric_limits<double>::digits10);
+	if (std::size(header.direction) == std::size(header.size) * std::size(header.size))
+	{
+		stream << "TransformMatrix =";
+		for (auto item : header.direction)
+			stream << " " << item;
+		stream << "\n";
+	}
+	if (std::size(header.offset) == std::size(header.size))
+	{
+		stream << "Offset =";
+		for (auto item : header.offset)
+			stream << " " << item;
+		stream << "\n";
+	}
+	stream.precision(precision);
+	stream << "ElementSpacing =";
+	for (auto item : header.spacing)
+		stream << " " << item;
+	stream << "\nDimSize =";
+	for (auto item : header.size)
+		stream << " " << item;
+	stream << "\nElementType = " << header.elementType << "\n";
+
+	header.compressed = false;
+	header.msb = false;
+	header.channels = 1;
+	header.headerSize = 0;
+	if (detached)
+	{
+		const auto rawName = fileName.substr(0, fileName.size() - 4) + ".raw";
+		stream << "ElementDataFile = " << getFileName(rawName) << "\n";
+		header.dataFile = rawName;
+		header.dataOffset = 0;
+	}
+	else
+	{
+		stream << "ElementDataFile = LOCAL\n";
+		auto text = stream.str();
+		/*Padding goes before the spacing values, where blanks are skipped by any reader*/
+		const auto pad = (DATA_ALIGNMENT - text.size() % DATA_ALIGNMENT) % DATA_ALIGNMENT;
+		text.insert(text.find("ElementSpacing =") + 16, pad, ' ');
+		header.dataFile = fileName;
+		header.dataOffset = text.size();
+		return text;
+	}
+	return stream.str();
+}
+
+/*
+@brief: Writes header of a MetaImage file. See formatMetaImageHeader.
+@param: fileName Name of the .mha or .mhd file.
+@param: header Header to be written. Its data file and offset are updated.
+@return: True on success.
+*/
+inline bool writeMetaImageHeader(const std::string& fileName, MetaImageHeader& header)
+{
+	const auto text = formatMetaImageHeader(fileName, header);
+	std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+	if (!file)
+		return false;
+	file << text;
+	return static_cast<bool>(file);
+}
+
+#endif
@@ -0,0 +1,513 @@
+/*
+ * Project: 3D Total Variation minimization
+ * Author: Gokhan Gunay, ghngunay@gmail.com
+ * Copyright: (C) 2018 by Gokhan Gunay
+ * License: GNU GPL v3 (see License.txt)
+ */
+
+#ifndef __TV_ENGINE__
+#define __TV_ENGINE__
+
+#include "tv_image.h"
+#include "tv_parallel.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <type_traits>
+#include <vector>
+
+/*
+@brief: Converts a float value into the given pixel type. Integral types are clamped
+to their range and rounded to the nearest integer.
+@param: in Value to be converted.
+@return: Converted value.
+*/
+template<typename T>
+inline T castPixel(const float in)
+{
+	if constexpr (std::is_integral<T>::value)
+	{
+		const double lo = static_cast<double>(std::numeric_limits<T>::lowest());
+		const double hi = static_cast<double>(std::numeric_limits<T>::max());
+		return static_cast<T>(std::round(std::min(std::max(static_cast<double>(in), lo), hi)));
+	}
+	else
+	{
+		return static_cast<T>(in);
+	}
+}
+
+/*
+Implementations of the iteration. OPERATOR composes the TVimage operators, FUSED computes
+each iteration in two passes over the image without temporaries and can use threads.
+*/
+enum class TVkernel
+{
+	OPERATOR,
+	FUSED
+};
+
+/*
+Execution configuration of the engine, it does not change the result.
+*/
+struct TVconfig
+{
+	TVkernel kernel = TVkernel::OPERATOR;
+	/*Number of threads*/
+	unsigned int threads = 1;
+	/*Planes of the last axis processed by a thread at once in the fused kernel*/
+	unsigned int tile = 1;
+};
+
+/*
+Hooks of the fused kernel for an image decomposed along its last axis into slabs with
+one halo plane on both sides, see TVmpiEngine. The defaults belong to a whole image:
+nothing is exchanged and every pixel is owned.
+*/
+struct TVhalo
+{
+	/*Owned pixels, read from the input and written to the output*/
+	size_t begin = 0;
+	size_t end = std::numeric_limits<size_t>::max();
+	/*If set, receives the sums of the squared change and of the squared value of the
+	dual variable over the owned pixels in the last iteration*/
+	double* residual = nullptr;
+
+	/*Called on data whose forward differences along the last axis are taken next*/
+	void fillUpper(float*)
+	{
+	}
+
+	/*Called on the dual variable of the last axis before its backward differences are taken*/
+	void fillLower(float*)
+	{
+	}
+};
+
+class TVengine
+{
+public:
+	static constexpr float EPSILON = 0.0000001f;
+	static constexpr unsigned int MAX_FUSED_DIM = 8;
+
+	/*
+	@brief: Sets "to" in the algorithm.
+	@param: to To value.
+	@return:
+	*/
+	void setTo(const float to) noexcept
+	{
+		m_to = to;
+	}
+
+	/*
+	@brief: Sets iteration number.
+	@param: it Iteration number in the optimization.
+	@return:
+	*/
+	void setIt(const unsigned int it) noexcept
+	{
+		m_it = it;
+	}
+
+	/*
+	@brief: Sets "lambda" weight in the algorithm.
+	@param: lam Lambda value.
+	@return:
+	*/
+	void setLambda(const float lam) noexcept
+	{
+		m_lm = lam;
+	}
+
+	/*
+	@brief: Sets execution configuration.
+	@param: config Kernel, threads and tile to be used.
+	@return:
+	*/
+	void setConfig(const TVconfig config) noexcept
+	{
+		m_config = config;
+	}
+
+	auto getConfig() const noexcept
+	{
+		return m_config;
+	}
+
+	auto getTo() const noexcept
+	{
+		return EPSILON + m_to;
+	}
+
+	auto getIt() const noexcept
+	{
+		return m_it;
+	}
+
+	auto getLambda() const noexcept
+	{
+		return EPSILON + m_lm;
+	}
+
+	/*
+	@brief: Computes scaling of the image dimensions.
+	@param: spacing Pixel size vector.
+	@return: Scaling vector.
+	*/
+	static std::vector<float> computeScaling(const std::vector<float> spacing)
+	{
+		float r = 0.f;
+		const int dim_ = std::size(spacing);
+		std::vector<float> scaling(dim_);
+		for (int i = 0; i < dim_; i++)
+		{
+			r += 1 / ((spacing[i] + EPSILON) * (spacing[i] + EPSILON));
+		}
+		r = sqrt(static_cast<float>(dim_) / r);
+		for (int i = 0; i < dim_; i++)
+		{
+			scaling[i] = r / (spacing[i] + EPSILON);
+		}
+		return scaling;
+	}
+
+	/*
+	@brief: Core of the algorithm. Conversion from the input pixel type is fused into
+	the first pass and conversion to the output pixel type into the last one, so only
+	the working image holds float data.
+	@param: pIn Pointer to the input pixels.
+	@param: im Working image having the size of the data to be processed.
+	@param: pOut Pointer to where the output pixels will be written.
+	@return:
+	*/
+	template<typename TIn, typename T, typename TOut>
+	void run(const TIn* pIn, T& im, TOut* pOut) const
+	{
+		TVhalo halo;
+		if (TVkernel::FUSED == m_config.kernel && im.getDim() <= MAX_FUSED_DIM)
+			runFused(pIn, im, pOut, halo);
+		else
+			runOperator(pIn, im, pOut);
+	}
+
+	/*
+	@brief: Runs the fused kernel on a slab of a decomposed image. The input and output
+	pixels are those of the owned range of the halo.
+	@param: pIn Pointer to the input pixels.
+	@param: im Working image covering the slab and its halo planes.
+	@param: pOut Pointer to where the output pixels will be written.
+	@param: halo Hooks exchanging the halo planes, see TVhalo.
+	@return:
+	*/
+	template<typename TIn, typename T, typename TOut, typename H>
+	void runHalo(const TIn* pIn, T& im, TOut* pOut, H& halo) const
+	{
+		runFused(pIn, im, pOut, halo);
+	}
+
+	/*
+	@brief: Runs the algorithm on consecutive images of the same size, e.g. slices of
+	a volume. The images are distributed over the threads of the configuration.
+	@param: pIn Pointer to the input pixels.
+	@param: pOut Pointer to where the output pixels will be written.
+	@param: size_ Size of an image.
+	@param: scaling Scaling of the image dimensions.
+	@param: cnt Number of the images.
+	@return:
+	*/
+	template<bool IsIso, typename TIn, typename TOut>
+	void runBatch(const TIn* pIn, TOut* pOut, const std::vector<size_t>& size_, const std::vector<float>& scaling, const size_t cnt) const
+	{
+		auto single = *this;
+		if (cnt > 1)
+			single.m_config.threads = 1;
+		const auto nThreads = std::max(1u, m_config.threads);
+		const auto grain = (cnt + nThreads - 1) / nThreads;
+		auto oper = [&](const size_t begin, const size_t end)
+		{
+			TVimage<IsIso> im(size_);
+			im.setScaling(scaling);
+			const auto sz_ = std::size(im);
+			for (auto ind = begin; ind < end; ++ind)
+			{
+				single.run(pIn + ind * sz_, im, pOut + ind * sz_);
+			}
+		};
+		parallelFor(cnt, grain, nThreads, oper);
+	}
+
+private:
+	template<typename TIn, typename T, typename TOut>
+	void runOperator(const TIn* pIn, T& im, TOut* pOut) const
+	{
+		const float lambda = getLambda();
+		const float to = getTo();
+		const auto sz = std::size(im);
+
+		/*First pass reads the input pixels and scales them into the working image*/
+		auto pIm = std::data(im);
+		for (size_t ind = 0; ind < sz; ++ind)
+		{
+			pIm[ind] = static_cast<float>(pIn[ind]) / lambda;
+		}
+		auto& out = im;
+		auto vP = out.getGradient();
+		auto midP = T::getDivergence(vP) - out;
+		auto psi = midP.getGradient();
+		auto r = (psi[0] * psi[0]);
+
+		const auto dm = std::size(vP);
+		const auto nIt = m_it - 1;
+		for (auto it = 0u; it < nIt; it++)
+		{
+			midP = T::getDivergence(vP) - out;
+			psi = midP.getGradient();
+			for (auto ind = 0u; ind < dm; ++ind)
+			{
+				r += (psi[ind] * psi[ind]);
+			}
+			r.transform(sqrtf);
+			r = (r * to) + 1;
+			for (auto ind = 0u; ind < dm; ++ind)
+			{
+				vP[ind] = (vP[ind] + psi[ind] * to);
+				vP[ind] /= r;
+			}
+		}
+
+		/*Last pass writes the result directly in the output pixel type*/
+		const auto div = T::getDivergence(vP);
+		const auto pDiv = std::data(div);
+		for (size_t ind = 0; ind < sz; ++ind)
+		{
+			pOut[ind] = castPixel<TOut>(lambda * (pIm[ind] - pDiv[ind]));
+		}
+	}
+
+	template<typename TIn, typename T, typename TOut, typename H>
+	void runFused(const TIn* pIn, T& im, TOut* pOut, H& halo) const
+	{
+		constexpr bool IsIso = T::isIsotropic;
+		using Flags = std::array<bool, MAX_FUSED_DIM>;
+		const float lambda = getLambda();
+		const float to = getTo();
+		const auto size_ = im.getSize();
+		const auto stride = im.getStride();
+		const auto dm = im.getDim();
+		const auto sz = std::size(im);
+		const size_t nx = size_[0];
+		const size_t nRows = sz / nx;
+		const size_t ownedBegin = halo.begin;
+		const size_t ownedEnd = std::min(sz, halo.end);
+		float sc[MAX_FUSED_DIM];
+		const auto scale = im.getScaling();
+		for (auto d = 0u; d < dm; ++d)
+			sc[d] = d < std::size(scale) ? scale[d] : 1.f;
+
+		/*Work is distributed in tiles of planes of the last axis*/
+		const size_t nUnits = dm > 1 ? size_[dm - 1] : 1;
+		const size_t grain = std::max<size_t>(m_config.tile, 1) * (nRows / nUnits);
+		const auto nThreads = std::max(1u, m_config.threads);
+
+		float* const out = std::data(im);
+		std::vector<std::vector<float>> vP(dm, std::vector<float>(sz));
+		std::vector<float> midP(sz);
+		std::vector<float> r(sz);
+
+		/*
+		Visits the rows of the image in blocks distributed over the threads. The operation
+		is called with the index of the first pixel of a row, flags telling if the row is
+		on the first or last position along each axis other than the first one, and a
+		scratch buffer of (dm + 1) rows owned by the calling thread.
+		*/
+		auto parallelRows = [&](auto operation)
+		{
+			parallelFor(nRows, grain, nThreads, [&](const size_t begin, const size_t end)
+			{
+				std::vector<float> scratch((dm + 1) * nx);
+				size_t coord[MAX_FUSED_DIM] = {};
+				size_t rem = begin;
+				for (auto d = 1u; d < dm; ++d)
+				{
+					coord[d] = rem % size_[d];
+					rem /= size_[d];
+				}
+				Flags first{}, last{};
+				for (auto row = begin; row < end; ++row)
+				{
+					for (auto d = 1u; d < dm; ++d)
+					{
+						first[d] = (0 == coord[d]);
+						last[d] = (size_[d] - 1 == coord[d]);
+					}
+					operation(row * nx, first, last, std::data(scratch));
+					/*Position of the next row, advanced like an odometer*/
+					for (auto d = 1u; d < dm && size_[d] == ++coord[d]; ++d)
+						coord[d] = 0;
+				}
+			});
+		};
+		auto scaled = [](const float diff, const float s)
+		{
+			if constexpr (IsIso)
+				return diff;
+			else
+				return s * diff;
+		};
+		/*Forward differences of a row along an axis, they vanish on its last position*/
+		auto forwardRow = [&](float* dst, const float* p, const unsigned int d, const Flags& last)
+		{
+			if (0 == d)
+			{
+				const float s = sc[0];
+				for (size_t x = 0; x + 1 < nx; ++x)
+					dst[x] = scaled(p[x + 1] - p[x], s);
+				dst[nx - 1] = 0.f;
+			}
+			else if (last[d])
+			{
+				std::fill(dst, dst + nx, 0.f);
+			}
+			else
+			{
+				const float* q = p + stride[d];
+				const float s = sc[d];
+				for (size_t x = 0; x < nx; ++x)
+					dst[x] = scaled(q[x] - p[x], s);
+			}
+		};
+		/*Divergence of the dual variable on a row, backward differences vanish on the first position*/
+		auto divergenceRow = [&](float* dst, const size_t base, const Flags& first)
+		{
+			const float* p = std::data(vP[0]) + base;
+			const float s0 = sc[0];
+			dst[0] = 0.f;
+			for (size_t x = 1; x < nx; ++x)
+				dst[x] = scaled(p[x] - p[x - 1], s0);
+			for (auto d = 1u; d < dm; ++d)
+			{
+				if (first[d])
+					continue;
+				const float* q = std::data(vP[d]) + base;
+				const float* qb = q - stride[d];
+				const float s = sc[d];
+				for (size_t x = 0; x < nx; ++x)
+					dst[x] += scaled(q[x] - qb[x], s);
+			}
+		};
+		auto updateMid = [&](const size_t base, const Flags& first, const Flags&, float*)
+		{
+			float* m = std::data(midP) + base;
+			const float* o = out + base;
+			divergenceRow(m, base, first);
+			for (size_t x = 0; x < nx; ++x)
+				m[x] = m[x] - o[x];
+		};
+
+		/*First pass reads the input pixels and scales them into the working image*/
+		parallelFor(ownedEnd - ownedBegin, grain * nx, nThreads, [&](const size_t first, const size_t last)
+		{
+			for (auto ind = first; ind < last; ++ind)
+				out[ownedBegin + ind] = static_cast<float>(pIn[ind]) / lambda;
+		});
+		halo.fillUpper(out);
+		parallelRows([&](const size_t base, const Flags&, const Flags& last, float*)
+		{
+			for (auto d = 0u; d < dm; ++d)
+				forwardRow(std::data(vP[d]) + base, out + base, d, last);
+		});
+		halo.fillLower(std::data(vP[dm - 1]));
+		/*Only the first axis enters the initial normalization term, it stays within the row*/
+		parallelRows([&](const size_t base, const Flags& first, const Flags& last, float* scratch)
+		{
+			updateMid(base, first, last, scratch);
+			forwardRow(scratch, std::data(midP) + base, 0, last);
+			float* rr = std::data(r) + base;
+			for (size_t x = 0; x < nx; ++x)
+				rr[x] = scratch[x] * scratch[x];
+		});
+		halo.fillUpper(std::data(midP));
+
+		std::mutex residualMutex;
+		const auto nIt = m_it - 1;
+		for (auto it = 0u; it < nIt; it++)
+		{
+			halo.fillLower(std::data(vP[dm - 1]));
+			parallelRows(updateMid);
+			halo.fillUpper(std::data(midP));
+			const bool isResidual = halo.residual && it + 1 == nIt;
+			parallelRows([&](const size_t base, const Flags&, const Flags& last, float* scratch)
+			{
+				const float t = to;
+				float* rr = scratch + dm * nx;
+				const float* m = std::data(midP) + base;
+				float* rOut = std::data(r) + base;
+				for (size_t x = 0; x < nx; ++x)
+					rr[x] = rOut[x];
+				for (auto d = 0u; d < dm; ++d)
+				{
+					float* psi = scratch + d * nx;
+					forwardRow(psi, m, d, last);
+					for (size_t x = 0; x < nx; ++x)
+						rr[x] += psi[x] * psi[x];
+				}
+				for (size_t x = 0; x < nx; ++x)
+				{
+					rr[x] = sqrtf(rr[x]) * t + 1;
+					rOut[x] = rr[x];
+				}
+				if (isResidual && base >= ownedBegin && base < ownedEnd)
+				{
+					double sums[2] = { 0.0, 0.0 };
+					for (auto d = 0u; d < dm; ++d)
+					{
+						const float* psi = scratch + d * nx;
+						const float* v = std::data(vP[d]) + base;
+						for (size_t x = 0; x < nx; ++x)
+						{
+							const float next = (v[x] + psi[x] * t) / rr[x];
+							const double diff = next - v[x];
+							sums[0] += diff * diff;
+							sums[1] += static_cast<double>(next) * next;
+						}
+					}
+					std::lock_guard<std::mutex> lock(residualMutex);
+					halo.residual[0] += sums[0];
+					halo.residual[1] += sums[1];
+				}
+				for (auto d = 0u; d < dm; ++d)
+				{
+					const float* psi = scratch + d * nx;
+					float* v = std::data(vP[d]) + base;
+					for (size_t x = 0; x < nx; ++x)
+						v[x] = (v[x] + psi[x] * t) / rr[x];
+				}
+			});
+		}
+
+		/*Last pass writes the result of the owned pixels directly in the output pixel type*/
+		halo.fillLower(std::data(vP[dm - 1]));
+		parallelRows([&](const size_t base, const Flags& first, const Flags&, float* scratch)
+		{
+			if (base < ownedBegin || base >= ownedEnd)
+				return;
+			divergenceRow(scratch, base, first);
+			const float lm = lambda;
+			const float* o = out + base;
+			TOut* dst = pOut + (base - ownedBegin);
+			for (size_t x = 0; x < nx; ++x)
+				dst[x] = castPixel<TOut>(lm * (o[x] - scratch[x]));
+		});
+	}
+
+	TVconfig m_config;
+	unsigned int m_it = 10;
+	float m_to = 0.15f;
+	float m_lm = 0.0f;
+};
+
+#endif
@@ -10,6 +10,7 @@
 
 #include <vector>
 #include <iterator>
+#include <type_traits>
 
 template<bool IsIsotropic = true>
 class TVimage
@@ -22,6 +23,8 @@ public:
 	};
 
 	using ThisType = TVimage<IsIsotropic>;
+	static constexpr bool isIsotropic = IsIsotropic;
+
 	explicit TVimage()
 		: m_stride{ std::vector<size_t>(1,1) }
 		, m_dim{ 1 }
@@ -35,7 +38,13 @@ public:
 		allocateMem(initialVal);
 	}
 
-	template<typename... Args>
+	template<typename T, typename std::enable_if_t<std::is_integral<T>::value, int> = 0>
+	explicit TVimage(const std::vector<T> size__, const float initialVal = 0.f)
+		: TVimage(std::vector<size_t>(std::begin(size__), std::end(size__)), initialVal)
+	{
+	}
+
+	template<typename... Args, typename std::enable_if_t<(std::is_integral<Args>::value && ...), int> = 0>
 	explicit TVimage(const Args... T)
 		: TVimage()
 	{
@@ -67,7 +76,7 @@ public:
 	{
 		m_dim = sizeof...(args);
 		std::vector<size_t> size(m_dim);
-		fillIndex(std::data(size), m_dim, args...);
+		fillIndex(std::data(size), args...);
 		setSize(size);
 	}
 
@@ -196,6 +205,7 @@ public:
 		if (getSize() != inIm.getSize())
 			return out;
 		out = ThisType(getSize());
+		out.setScaling(m_scale);
 		const unsigned int strd = std::size(out);
 		auto ptrIn1 = std::data(*this);
 		auto ptrIn2 = std::data(inIm);
@@ -429,6 +439,11 @@ public:
 		return m_stride;
 	}
 
+	auto getScaling() const noexcept
+	{
+		return m_scale;
+	}
+
 	auto begin()
 	{
 		return std::begin(m_cont);
@@ -475,7 +490,11 @@ private:
 	void fillIndex(size_t* ptr, const T dim, const ArgT... args)
 	{
 		fillIndex(ptr, dim);
-		fillIndex(ptr, dim, args...);
+		fillIndex(ptr, args...);
+	}
+
+	void fillIndex(size_t*)
+	{
 	}
 
 	std::vector<float> m_cont;
@@ -0,0 +1,82 @@
+/*
+ * Project: 3D Total Variation minimization
+ * Author: Gokhan Gunay, ghngunay@gmail.com
+ * Copyright: (C) 2018 by Gokhan Gunay
+ * License: GNU GPL v3 (see License.txt)
+ */
+
+#ifndef __TV_PARALLEL__
+#define __TV_PARALLEL__
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+@brief: Applies an operation to the range [0, count) using the given number of threads.
+The range is split into blocks which are picked up by the threads in order. An exception
+thrown by the operation is rethrown on the calling thread after all threads are joined.
+@param: count Length of the range.
+@param: grain Length of a block.
+@param: nThreads Number of threads including the calling one.
+@param: operation Operation called with the begin and end of a block.
+@return:
+*/
+template<typename OperationT>
+void parallelFor(const size_t count, size_t grain, const unsigned int nThreads, OperationT operation)
+{
+	grain = std::max<size_t>(grain, 1);
+	if (nThreads <= 1 || count <= grain)
+	{
+		operation(size_t(0), count);
+		return;
+	}
+
+	std::atomic<size_t> next{ 0 };
+	std::exception_ptr error;
+	std::mutex errorMutex;
+	auto worker = [&]()
+	{
+		try
+		{
+			for (;;)
+			{
+				const size_t begin = next.fetch_add(grain);
+				if (begin >= count)
+					break;
+				operation(begin, std::min(count, begin + grain));
+			}
+		}
+		catch (...)
+		{
+			/*First exception is kept and the remaining blocks are dropped*/
+			std::lock_guard<std::mutex> lock(errorMutex);
+			if (!error)
+				error = std::current_exception();
+			next = count;
+		}
+	};
+	const auto nBlocks = (count + grain - 1) / grain;
+	const auto nWorkers = static_cast<unsigned int>(std::min<size_t>(nThreads, nBlocks));
+	std::vector<std::thread> pool;
+	try
+	{
+		pool.reserve(nWorkers - 1);
+		for (auto ind = 1u; ind < nWorkers; ++ind)
+			pool.emplace_back(worker);
+	}
+	catch (...)
+	{
+		/*Threads that could not be started are replaced by the ones running*/
+	}
+	worker();
+	for (auto& item : pool)
+		item.join();
+	if (error)
+		std::rethrow_exception(error);
+}
+
+#endif
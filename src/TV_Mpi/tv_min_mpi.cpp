@@ -0,0 +1,240 @@
+/*
+ * Project: 3D Total Variation minimization
+ * Author: Gokhan Gunay, ghngunay@gmail.com
+ * Copyright: (C) 2018 by Gokhan Gunay
+ * License: GNU GPL v3 (see License.txt)
+ */
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <mpi.h>
+
+#include "ArgumentParser.hpp"
+#include "tv_engine.h"
+#include "tv_metaimage.h"
+#include "tv_mpi_engine.h"
+
+using namespace std;
+
+/*
+@brief: Reads or writes the planes of a rank through MPI-IO.
+@param: fileName Name of the data file.
+@param: offset Byte offset of the first plane in the file.
+@param: slab Planes of the rank.
+@param: planeBytes Size of a plane in bytes.
+@param: ptr Buffer of the planes.
+@param: write Writes the planes if true, reads them otherwise.
+@return: True on success.
+*/
+bool transferSlab(const std::string& fileName, const size_t offset, const TVslab slab, const size_t planeBytes, void* ptr, const bool write)
+{
+	MPI_File fh;
+	const int mode = write ? (MPI_MODE_WRONLY | MPI_MODE_CREATE) : MPI_MODE_RDONLY;
+	if (MPI_SUCCESS != MPI_File_open(MPI_COMM_WORLD, fileName.c_str(), mode, MPI_INFO_NULL, &fh))
+		return false;
+
+	/*A plane is used as the transfer unit so the element count fits into an int*/
+	MPI_Datatype planeType;
+	MPI_Type_contiguous(static_cast<int>(planeBytes), MPI_BYTE, &planeType);
+	MPI_Type_commit(&planeType);
+	const MPI_Offset pos = static_cast<MPI_Offset>(offset + slab.begin * planeBytes);
+	const int cnt = static_cast<int>(slab.count);
+	int err;
+	if (write)
+		err = MPI_File_write_at_all(fh, pos, ptr, cnt, planeType, MPI_STATUS_IGNORE);
+	else
+		err = MPI_File_read_at_all(fh, pos, ptr, cnt, planeType, MPI_STATUS_IGNORE);
+	MPI_Type_free(&planeType);
+	MPI_File_close(&fh);
+	return MPI_SUCCESS == err;
+}
+
+/*
+@brief: Runs the algorithm on the planes of a rank.
+@param: buffer Pixels of the planes, overwritten by the result.
+@param: size_ Size of the image or of a slice in slice by slice mode.
+@param: spacing Pixel spacing matching size_.
+@param: slab Planes of the rank.
+@param: sliced Slice by slice processing.
+@param: engine Engine holding the parameters of the algorithm.
+@return: Residual of the distributed engine, 0 in slice by slice mode.
+*/
+template<bool IsIso, typename PixelType>
+double solve(std::vector<PixelType>& buffer, std::vector<size_t> size_, const std::vector<float>& spacing, const TVslab slab, const bool sliced, const TVengine& engine)
+{
+	auto scaling = TVengine::computeScaling(spacing);
+	if (sliced)
+	{
+		TVimage<IsIso> im(size_);
+		im.setScaling(scaling);
+		const auto sz_ = std::size(im);
+		for (size_t ind = 0; ind < slab.count; ++ind)
+		{
+			engine.run(std::data(buffer) + ind * sz_, im, std::data(buffer) + ind * sz_);
+		}
+		return 0.0;
+	}
+	size_.back() = slab.count + 2;
+	TVimage<IsIso> im(size_);
+	im.setScaling(scaling);
+	TVmpiEngine mpiEngine(engine);
+	mpiEngine.run(std::data(buffer), im, std::data(buffer));
+	return mpiEngine.getResidual();
+}
+
+/*
+@brief: Denoises the image with the given pixel type. Both images are MetaImage files
+and each rank reads and writes only its own planes.
+@param: header Header of the input image.
+@param: outFile Name of the output image.
+@param: engine Engine holding the parameters of the algorithm.
+@param: isIso Isotropic processing.
+@param: slc Slice by slice processing.
+@param: verbose Prints the decomposition and the residual.
+@return: Exit status.
+*/
+template<typename PixelType>
+int process(const MetaImageHeader& header, const std::string& outFile, const TVengine& engine, const bool isIso, const bool slc, const bool verbose)
+{
+	int rank, nRanks;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+	MPI_Comm_size(MPI_COMM_WORLD, &nRanks);
+
+	auto size_ = header.size;
+	auto spacing = header.spacing;
+	const auto dim = std::size(size_);
+
+	/*Slices are independent in slice by slice mode, so they are distributed without halos*/
+	const bool sliced = slc && dim > 2;
+	size_t cnt = size_[dim - 1];
+	if (sliced)
+	{
+		cnt = 1;
+		for (auto ind = 2u; ind < dim; ++ind)
+			cnt *= size_[ind];
+		spacing.resize(2);
+		size_.resize(2);
+	}
+	size_t plane = 1;
+	for (auto ind = 0u; ind < (sliced ? 2 : dim - 1); ++ind)
+		plane *= size_[ind];
+	const auto planeBytes = plane * sizeof(PixelType);
+
+	/*Checked on every rank, a rank without planes must not leave the others in a collective call*/
+	if (cnt < static_cast<size_t>(nRanks))
+	{
+		if (0 == rank)
+			std::cerr << "Too many processes for the image size" << std::endl;
+		return EXIT_FAILURE;
+	}
+	const auto slab = getSlab(cnt, rank, nRanks);
+
+	std::vector<PixelType> buffer(slab.count * plane);
+	if (!transferSlab(header.dataFile, header.dataOffset, slab, planeBytes, std::data(buffer), false))
+	{
+		if (0 == rank)
+			std::cerr << "Invalid input image" << std::endl;
+		return EXIT_FAILURE;
+	}
+	if (verbose)
+		cout << "Rank " << rank << ": planes " << slab.begin << "-" << slab.begin + slab.count - 1 << "\n";
+
+	/*Is image to be processed isotropically?*/
+	const double residual = !isIso
+		? solve<true>(buffer, size_, spacing, slab, sliced, engine)
+		: solve<false>(buffer, size_, spacing, slab, sliced, engine);
+	if (verbose && 0 == rank && !sliced)
+		cout << "Residual:" << residual << "\n";
+
+	/*Header is written by the first rank, the others only need the data offset*/
+	auto outHeader = header;
+	const auto text = formatMetaImageHeader(outFile, outHeader);
+	int ok = 1;
+	if (0 == rank)
+	{
+		std::ofstream file(outFile, std::ios::binary | std::ios::trunc);
+		file << text;
+		ok = static_cast<bool>(file) ? 1 : 0;
+		if (outHeader.dataFile != outFile)
+			std::ofstream(outHeader.dataFile, std::ios::binary | std::ios::trunc);
+	}
+	MPI_Bcast(&ok, 1, MPI_INT, 0, MPI_COMM_WORLD);
+	if (!ok || !transferSlab(outHeader.dataFile, outHeader.dataOffset, slab, planeBytes, std::data(buffer), true))
+	{
+		if (0 == rank)
+			std::cerr << "Invalid output image" << std::endl;
+		return EXIT_FAILURE;
+	}
+	return 0;
+}
+
+int main(int argc, char * argv[])
+{
+	MPI_Init(&argc, &argv);
+	int rank;
+	MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+	Cparser parser(argc, argv);
+	parser.save_key("in_file", "-in");
+	parser.save_key("out_file", "-out");
+	parser.save_key("lambda", "-l");
+	parser.save_key("iter", "-it");
+	parser.save_key("verbose", "-v");
+	parser.save_key("IsIsotropic", "-iso");
+	parser.save_key("SliceBySlice", "-slc");
+
+	if (!parser["in_file"].is_called() || !parser["out_file"].is_called())
+	{
+		if (0 == rank)
+			std::cout << "Input and output files must be set!!" << std::endl;
+		MPI_Finalize();
+		return EXIT_FAILURE;
+	}
+
+	MetaImageHeader header;
+	const auto inFile = parser["in_file"].get_as_string()[0];
+	if (!readMetaImageHeader(inFile, header) || !header.isRaw())
+	{
+		if (0 == rank)
+			std::cerr << "Input must be an uncompressed little endian MetaImage of uchar, short, ushort or float" << std::endl;
+		MPI_Finalize();
+		return EXIT_FAILURE;
+	}
+	const auto outFile = parser["out_file"].get_as_string()[0];
+	if (0 == rank)
+	{
+		cout << "In File:" << inFile << "\n";
+		cout << "Out File:" << outFile << "\n";
+	}
+
+	TVengine engine;
+	auto lmbd = parser["lambda"].get_as_float();
+	if (!std::empty(lmbd))
+	{
+		engine.setLambda(lmbd[0]);
+	}
+	auto it = parser["iter"].get_as_integer();
+	if (!std::empty(it))
+	{
+		engine.setIt(it[0]);
+	}
+	const bool isIso = parser["IsIsotropic"].is_called();
+	const bool slc = parser["SliceBySlice"].is_called();
+	const bool verbose = parser["verbose"].is_called();
+
+	int ret;
+	if ("MET_UCHAR" == header.elementType)
+		ret = process<unsigned char>(header, outFile, engine, isIso, slc, verbose);
+	else if ("MET_SHORT" == header.elementType)
+		ret = process<short>(header, outFile, engine, isIso, slc, verbose);
+	else if ("MET_USHORT" == header.elementType)
+		ret = process<unsigned short>(header, outFile, engine, isIso, slc, verbose);
+	else
+		ret = process<float>(header, outFile, engine, isIso, slc, verbose);
+
+	MPI_Finalize();
+	return ret;
+}
@@ -0,0 +1,162 @@
+/*
+ * Project: 3D Total Variation minimization
+ * Author: Gokhan Gunay, ghngunay@gmail.com
+ * Copyright: (C) 2018 by Gokhan Gunay
+ * License: GNU GPL v3 (see License.txt)
+ */
+
+#ifndef __TV_MPI_ENGINE__
+#define __TV_MPI_ENGINE__
+
+#include "tv_engine.h"
+
+#include <mpi.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+/*
+Part of an axis assigned to a rank.
+*/
+struct TVslab
+{
+	size_t begin = 0;
+	size_t count = 0;
+};
+
+/*
+@brief: Splits an axis into nearly equal contiguous parts over the ranks.
+@param: length Length of the axis.
+@param: rank Rank whose part is requested.
+@param: nRanks Number of the ranks.
+@return: Part of the axis.
+*/
+inline TVslab getSlab(const size_t length, const int rank, const int nRanks)
+{
+	const size_t base = length / nRanks;
+	const size_t rem = length % nRanks;
+	const size_t r = static_cast<size_t>(rank);
+	TVslab slab;
+	slab.begin = r * base + std::min(r, rem);
+	slab.count = base + (r < rem ? 1 : 0);
+	return slab;
+}
+
+/*
+Distributed version of TVengine. The image is decomposed along its last axis and each
+rank keeps its planes plus one halo plane on both sides. The iteration is the fused
+kernel of TVengine, which exchanges the halos of the dual variable and of the image
+through TVhalo hooks, so the result matches the single process one.
+*/
+class TVmpiEngine
+{
+public:
+	explicit TVmpiEngine(const TVengine& engine, MPI_Comm comm = MPI_COMM_WORLD)
+		: m_engine{ engine }
+		, m_comm{ comm }
+	{
+		MPI_Comm_rank(m_comm, &m_rank);
+		MPI_Comm_size(m_comm, &m_nRanks);
+	}
+
+	/*
+	@brief: Runs the algorithm on the local slab with the fused kernel of the engine. Its
+	threads and tile come from the engine configuration.
+	@param: pIn Pointer to the input pixels of the local planes.
+	@param: im Working image. Its last axis must be two planes longer than the local slab.
+	@param: pOut Pointer to where the output pixels of the local planes will be written.
+	@return:
+	*/
+	template<typename TIn, typename T, typename TOut>
+	void run(const TIn* pIn, T& im, TOut* pOut)
+	{
+		const auto zAxis = im.getDim() - 1;
+		m_plane = im.getStride()[zAxis];
+		m_nPlanes = im.getSize()[zAxis] - 2;
+
+		double local[2] = { 0.0, 0.0 };
+		Halo halo(*this);
+		halo.begin = m_plane;
+		halo.end = (m_nPlanes + 1) * m_plane;
+		halo.residual = local;
+		m_engine.runHalo(pIn, im, pOut, halo);
+
+		double global[2];
+		MPI_Allreduce(local, global, 2, MPI_DOUBLE, MPI_SUM, m_comm);
+		m_residual = global[1] > 0.0 ? std::sqrt(global[0] / global[1]) : 0.0;
+	}
+
+	/*
+	@brief: Gets relative change of the dual variable in the last iteration over all ranks.
+	@return: Residual, 0 if less than two iterations were run.
+	*/
+	auto getResidual() const noexcept
+	{
+		return m_residual;
+	}
+
+private:
+	/*Hooks of the engine exchanging the halo planes with the neighbor ranks*/
+	struct Halo : TVhalo
+	{
+		explicit Halo(TVmpiEngine& owner)
+			: m_owner{ owner }
+		{
+		}
+
+		void fillUpper(float* ptr)
+		{
+			m_owner.fillUpperHalo(ptr);
+		}
+
+		void fillLower(float* ptr)
+		{
+			m_owner.fillLowerHalo(ptr);
+		}
+
+		TVmpiEngine& m_owner;
+	};
+
+	/*
+	@brief: Fills the lower halo plane with the last local plane of the previous rank.
+	The first rank replicates its first plane so the backward difference vanishes there.
+	@param: ptr Pointer to the data including the halo planes.
+	@return:
+	*/
+	void fillLowerHalo(float* ptr)
+	{
+		const int prev = 0 == m_rank ? MPI_PROC_NULL : m_rank - 1;
+		const int next = m_nRanks - 1 == m_rank ? MPI_PROC_NULL : m_rank + 1;
+		MPI_Sendrecv(ptr + m_nPlanes * m_plane, static_cast<int>(m_plane), MPI_FLOAT, next, 0,
+			ptr, static_cast<int>(m_plane), MPI_FLOAT, prev, 0, m_comm, MPI_STATUS_IGNORE);
+		if (MPI_PROC_NULL == prev)
+			std::copy(ptr + m_plane, ptr + 2 * m_plane, ptr);
+	}
+
+	/*
+	@brief: Fills the upper halo plane with the first local plane of the next rank.
+	The last rank replicates its last plane so the forward difference vanishes there.
+	@param: ptr Pointer to the data including the halo planes.
+	@return:
+	*/
+	void fillUpperHalo(float* ptr)
+	{
+		const int prev = 0 == m_rank ? MPI_PROC_NULL : m_rank - 1;
+		const int next = m_nRanks - 1 == m_rank ? MPI_PROC_NULL : m_rank + 1;
+		const auto pUpper = ptr + (m_nPlanes + 1) * m_plane;
+		MPI_Sendrecv(ptr + m_plane, static_cast<int>(m_plane), MPI_FLOAT, prev, 1,
+			pUpper, static_cast<int>(m_plane), MPI_FLOAT, next, 1, m_comm, MPI_STATUS_IGNORE);
+		if (MPI_PROC_NULL == next)
+			std::copy(pUpper - m_plane, pUpper, pUpper);
+	}
+
+	TVengine m_engine;
+	MPI_Comm m_comm;
+	int m_rank = 0;
+	int m_nRanks = 1;
+	size_t m_plane = 0;
+	size_t m_nPlanes = 0;
+	double m_residual = 0.0;
+};
+
+#endif
@@ -0,0 +1,288 @@
+/*
+ * Project: 3D Total Variation minimization
+ * Author: Gokhan Gunay, ghngunay@gmail.com
+ * Copyright: (C) 2018 by Gokhan Gunay
+ * License: GNU GPL v3 (see License.txt)
+ */
+
+#ifndef __TV_AUTOTUNE__
+#define __TV_AUTOTUNE__
+
+#include "tv_engine.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+/*
+Chooses the execution configuration of TVengine by timing short trial solves on the
+actual input. Winners are kept in a text cache keyed by the CPU model and the image
+geometry, so later runs with the same kind of input skip the trials.
+*/
+class TVautotune
+{
+public:
+	/*Iterations of a trial solve*/
+	static constexpr unsigned int TRIAL_IT = 3;
+
+	/*
+	@brief: Gets model name of the CPU.
+	@return: Model name, "unknown" if it can not be determined.
+	*/
+	static std::string getCpuModel()
+	{
+		std::ifstream file("/proc/cpuinfo");
+		std::string line;
+		while (std::getline(file, line))
+		{
+			if (0 == line.compare(0, 10, "model name"))
+			{
+				const auto pos = line.find(':');
+				if (std::string::npos != pos)
+					return line.substr(line.find_first_not_of(" \t", pos + 1));
+			}
+		}
+		return "unknown";
+	}
+
+	/*
+	@brief: Gets id of the calling process.
+	@return: Process id.
+	*/
+	static long getProcessId()
+	{
+#if defined(_WIN32)
+		return static_cast<long>(_getpid());
+#else
+		return static_cast<long>(getpid());
+#endif
+	}
+
+	/*
+	@brief: Gets path of the cache file. TVMIN_TUNE_CACHE overrides the default location
+	in the user cache directory.
+	@return: Path of the cache file.
+	*/
+	static std::string getCachePath()
+	{
+		if (const char* path = std::getenv("TVMIN_TUNE_CACHE"))
+			return path;
+		if (const char* dir = std::getenv("XDG_CACHE_HOME"))
+			return std::string(dir) + "/tvmin_autotune.txt";
+		if (const char* dir = std::getenv("HOME"))
+			return std::string(dir) + "/.cache/tvmin_autotune.txt";
+		if (const char* dir = std::getenv("LOCALAPPDATA"))
+			return std::string(dir) + "\\tvmin_autotune.txt";
+		return "tvmin_autotune.txt";
+	}
+
+	/*
+	@brief: Builds the cache key of a problem.
+	@param: size_ Size of an image.
+	@param: cnt Number of the images processed in a batch.
+	@param: isIso Isotropic processing.
+	@return: Cache key.
+	*/
+	static std::string getKey(const std::vector<size_t>& size_, const size_t cnt, const bool isIso)
+	{
+		std::ostringstream stream;
+		stream << getCpuModel() << "/" << std::thread::hardware_concurrency();
+		for (size_t ind = 0; ind < std::size(size_); ++ind)
+			stream << (0 == ind ? "|" : "x") << size_[ind];
+		stream << "|" << cnt << "|" << (isIso ? "iso" : "aniso");
+		return stream.str();
+	}
+
+	/*
+	@brief: Looks a configuration up in the cache.
+	@param: key Cache key.
+	@param: config Configuration to be filled.
+	@return: True if the key was found.
+	*/
+	static bool load(const std::string& key, TVconfig& config)
+	{
+		std::ifstream file(getCachePath());
+		std::string line;
+		while (std::getline(file, line))
+		{
+			const auto pos = line.rfind('\t');
+			if (std::string::npos == pos || line.substr(0, pos) != key)
+				continue;
+			std::istringstream stream(line.substr(pos + 1));
+			int kernel;
+			if (stream >> kernel >> config.threads >> config.tile)
+			{
+				config.kernel = static_cast<TVkernel>(kernel);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/*
+	@brief: Stores a configuration in the cache replacing an older entry of the key.
+	@param: key Cache key.
+	@param: config Configuration to be stored.
+	@return: True if the cache could be written, a warning is printed otherwise.
+	*/
+	static bool store(const std::string& key, const TVconfig& config)
+	{
+		std::vector<std::string> lines;
+		{
+			std::ifstream file(getCachePath());
+			std::string line;
+			while (std::getline(file, line))
+			{
+				const auto pos = line.rfind('\t');
+				if (std::string::npos != pos && line.substr(0, pos) != key)
+					lines.emplace_back(line);
+			}
+		}
+		std::ostringstream stream;
+		stream << key << "\t" << static_cast<int>(config.kernel) << " " << config.threads << " " << config.tile;
+		lines.emplace_back(stream.str());
+
+		/*The default location may not exist yet on a fresh account*/
+		const auto path = getCachePath();
+		std::error_code error;
+		const auto dir = std::filesystem::path(path).parent_path();
+		if (!dir.empty())
+			std::filesystem::create_directories(dir, error);
+
+		/*Written aside and renamed, so concurrent runs never read a partly written cache*/
+		std::ostringstream tmpPath;
+		tmpPath << path << "." << getProcessId() << "." << std::hash<std::thread::id>()(std::this_thread::get_id()) << "." << std::chrono::steady_clock::now().time_since_epoch().count() << ".tmp";
+		bool ok;
+		{
+			std::ofstream file(tmpPath.str(), std::ios::trunc);
+			for (const auto& line : lines)
+				file << line << "\n";
+			ok = static_cast<bool>(file.flush());
+		}
+		if (ok && 0 != std::rename(tmpPath.str().c_str(), path.c_str()))
+		{
+			/*Renaming onto an existing file fails on Windows*/
+			std::remove(path.c_str());
+			ok = 0 == std::rename(tmpPath.str().c_str(), path.c_str());
+		}
+		if (!ok)
+		{
+			std::remove(tmpPath.str().c_str());
+			std::cerr << "Autotuning result could not be cached in " << path << std::endl;
+		}
+		return ok;
+	}
+
+	/*
+	@brief: Gets candidate configurations for a problem.
+	@param: size_ Size of an image.
+	@param: cnt Number of the images processed in a batch.
+	@return: Candidate configurations.
+	*/
+	static std::vector<TVconfig> getCandidates(const std::vector<size_t>& size_, const size_t cnt)
+	{
+		std::vector<unsigned int> threads{ 1 };
+		const auto maxThreads = std::max(1u, std::thread::hardware_concurrency());
+		for (auto th = 2u; th < maxThreads; th *= 2)
+			threads.emplace_back(th);
+		if (maxThreads > 1)
+			threads.emplace_back(maxThreads);
+
+		std::vector<TVconfig> out;
+		for (auto th : threads)
+		{
+			TVconfig config;
+			config.threads = th;
+			if (1 == th || cnt > 1)
+				out.emplace_back(config);
+
+			/*Tiles only matter if an image is shared by the threads*/
+			config.kernel = TVkernel::FUSED;
+			const auto depth = std::size(size_) > 1 ? size_.back() : 1;
+			for (auto tile : { 1u, 4u, 16u })
+			{
+				if (tile > 1 && (1 == th || cnt > 1 || tile * th > depth))
+					break;
+				config.tile = tile;
+				out.emplace_back(config);
+			}
+		}
+		return out;
+	}
+
+	/*
+	@brief: Times the candidate configurations on the input and returns the fastest one.
+	@param: engine Engine holding the parameters of the algorithm.
+	@param: pIn Pointer to the input pixels.
+	@param: pOut Pointer to the output pixels, overwritten by the trials.
+	@param: size_ Size of an image.
+	@param: scaling Scaling of the image dimensions.
+	@param: cnt Number of the images processed in a batch.
+	@return: Fastest configuration.
+	*/
+	template<bool IsIso, typename TIn, typename TOut>
+	static TVconfig tune(const TVengine& engine, const TIn* pIn, TOut* pOut, const std::vector<size_t>& size_, const std::vector<float>& scaling, const size_t cnt)
+	{
+		auto trial = engine;
+		trial.setIt(std::min(engine.getIt(), TRIAL_IT));
+
+		const auto candidates = getCandidates(size_, cnt);
+		/*Untimed run, so page faults of the output and allocator warm up are not charged to the first candidate*/
+		trial.setConfig(candidates.front());
+		trial.template runBatch<IsIso>(pIn, pOut, size_, scaling, cnt);
+
+		TVconfig best;
+		double bestTime = -1.0;
+		for (const auto& config : candidates)
+		{
+			trial.setConfig(config);
+			const auto start = std::chrono::steady_clock::now();
+			trial.template runBatch<IsIso>(pIn, pOut, size_, scaling, cnt);
+			const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+			if (bestTime < 0.0 || elapsed.count() < bestTime)
+			{
+				bestTime = elapsed.count();
+				best = config;
+			}
+		}
+		return best;
+	}
+
+	/*
+	@brief: Gets configuration of a problem from the cache, tunes and caches it if missing.
+	@param: engine Engine holding the parameters of the algorithm.
+	@param: pIn Pointer to the input pixels.
+	@param: pOut Pointer to the output pixels, overwritten if the trials are run.
+	@param: size_ Size of an image.
+	@param: scaling Scaling of the image dimensions.
+	@param: cnt Number of the images processed in a batch.
+	@return: Configuration to be used.
+	*/
+	template<bool IsIso, typename TIn, typename TOut>
+	static TVconfig getConfig(const TVengine& engine, const TIn* pIn, TOut* pOut, const std::vector<size_t>& size_, const std::vector<float>& scaling, const size_t cnt)
+	{
+		const auto key = getKey(size_, cnt, IsIso);
+		TVconfig config;
+		if (load(key, config))
+			return config;
+		config = tune<IsIso>(engine, pIn, pOut, size_, scaling, cnt);
+		store(key, config);
+		return config;
+	}
+};
+
+#endif
@@ -9,6 +9,8 @@
 #define __TV_FILTER_H__
 
 #include "tv_image.h"
+#include "tv_engine.h"
+#include "tv_autotune.h"
 
 #include "itkImageFunction.h"
 #include "itkImageRegionIterator.h"
@@ -29,6 +31,8 @@ public:
 	using Self = TotalVariationMinimization;
 	using Pointer = SmartPointer< Self >;
 	using ConstPointer = SmartPointer< const Self >;
+	using InputPixelType = typename TInputImage::PixelType;
+	using OutputPixelType = typename TOutputImage::PixelType;
 
 	itkNewMacro (Self);
 	itkTypeMacro(DiscreteGaussianImageFilter, ImageToImageFilter);
@@ -83,6 +87,38 @@ public:
 		m_sliceBySlice = slc;
 	}
 
+	/*
+	@brief: Sets execution configuration of the engine. It is not used if autotuning is on.
+	@param: config Kernel, threads and tile to be used.
+	@return:
+	*/
+	void SetConfig(const TVconfig& config) noexcept
+	{
+		m_config = config;
+	}
+
+	/*
+	@brief: Sets if the execution configuration will be chosen by timing trial solves.
+	The choice is cached per CPU model and image geometry for later runs.
+	@param: tune Autotuning value.
+	@return:
+	*/
+	void SetAutoTune(const bool tune) noexcept
+	{
+		m_autoTune = tune;
+	}
+
+	/*
+	@brief: Sets memory the output is written to instead of an allocated buffer, e.g. a
+	mapped file. It must hold the requested region of the output and outlive the filter.
+	@param: buffer Output buffer, nullptr to allocate.
+	@return:
+	*/
+	void SetOutputBuffer(OutputPixelType* buffer) noexcept
+	{
+		m_outputBuffer = buffer;
+	}
+
 	void PrintSelf(std::ostream & os, Indent indent) const override;
 
 protected:
@@ -99,25 +135,12 @@ private:
 	float m_lm = 0.0f;
 	bool m_isotropic = false;
 	bool m_sliceBySlice = false;
+	bool m_autoTune = false;
+	TVconfig m_config;
+	OutputPixelType* m_outputBuffer = nullptr;
 
 	template<bool IsIso>
 	void run();
-
-	/*
-	@brief: Core of the algorithm.
-	@param: in Input image.
-	@param: out Output image to be written.
-	@return:
-	*/
-	template<typename T>
-	void engine(T& in, T& out);
-
-	/*
-	@brief: Computes scaling of the image dimensions.
-	@param: in Pixel size vector.
-	@return: Scaling vector.
-	*/
-	std::vector<float> computeScaling(const std::vector<float> in) const;
 };
 
 }
@@ -18,18 +18,6 @@
 #ifndef tv_hxx
 #define tv_hxx
 
-constexpr float EPSILON = 0.0000001f;
-
-template<typename T1, typename T2>
-auto mv(T1 pIn, const size_t sz, T2* pOut)
-{
-	T1 const _end_ = pIn + sz;
-	for (; pIn < _end_;)
-	{
-		*pOut++ = static_cast<T2>(*pIn++);
-	}
-};
-
 namespace itk
 {
 
@@ -48,24 +36,6 @@ void TotalVariationMinimization<TInputImage, TOutputImage>::GenerateData()
 	/**Update and get result*/
 }
 
-template<typename TInputImage, typename TOutputImage>
-auto TotalVariationMinimization<TInputImage, TOutputImage>::computeScaling(const std::vector<float> spacing) const -> std::vector<float>
-{
-	float r = 0.f;
-	const int dim_ = std::size(spacing);
-	std::vector<float> scaling(dim_);
-	for (int i = 0; i < dim_; i++)
-	{
-		r += 1 / ((spacing[i] + EPSILON) * (spacing[i] + EPSILON));
-	}
-	r = sqrt(static_cast<float>(dim_) / r);
-	for (int i = 0; i < dim_; i++)
-	{	
-		scaling[i] = r / (spacing[i] + EPSILON);
-	}
-	return scaling;
-}
-
 template<typename TInputImage, typename TOutputImage>
 template<bool IsIso>
 void TotalVariationMinimization<TInputImage, TOutputImage>::run() 
@@ -97,63 +67,34 @@ void TotalVariationMinimization<TInputImage, TOutputImage>::run()
 	
 	auto out = this->GetOutput();
 	out->SetBufferedRegion(out->GetRequestedRegion());
-	out->Allocate();
+	if (m_outputBuffer)
+	{
+		/*Solver fills the external buffer in place, it is not released by the image*/
+		out->GetPixelContainer()->SetImportPointer(m_outputBuffer, out->GetRequestedRegion().GetNumberOfPixels(), false);
+	}
+	else
+	{
+		out->Allocate();
+	}
 	auto pOut = out->GetBufferPointer();
 
 	/*If image slice thickness differs in each direction, get scaling weights for
 	* gradient and divergence operators*/
-	auto scaling = computeScaling(spacing);
+	auto scaling = TVengine::computeScaling(spacing);
 
-	TVimage<IsIso> im(size_);
-	im.setScaling(scaling);
-	
-	for (auto ind = 0u; ind < cnt; ++ind)
+	TVengine engine;
+	engine.setIt(m_it);
+	engine.setTo(m_to);
+	engine.setLambda(m_lm);
+	if (m_autoTune)
 	{
-		const auto sz_ = std::size(im);
-		mv(pIn + ind * sz_, sz_, std::data(im));
-		engine(im, im);
-		mv(std::data(im), sz_, pOut + ind * sz_);
+		engine.setConfig(TVautotune::getConfig<IsIso>(engine, pIn, pOut, size_, scaling, cnt));
 	}
-}
-
-template<typename TInputImage, typename TOutputImage>
-template<typename T>
-void TotalVariationMinimization<TInputImage, TOutputImage>::engine(T& in, T& out) 
-{
-	const float lambda = EPSILON + m_lm;
-	const float to = EPSILON + m_to;
-	
-	out = in / lambda;
-	auto vP = in.getGradient();
-	auto midP = TVimage<>::getDivergence(vP) - out;
-	auto psi = midP.getGradient();
-	auto r = (psi[0] * psi[0]);
-
-	const auto dm = std::size(vP);
-	const auto nIt = m_it - 1;
-	for (auto it = 0u; it < nIt; it++)
+	else
 	{
-		midP = TVimage<>::getDivergence(vP) - out;
-		psi = midP.getGradient();
-		for (auto ind = 0u; ind < dm; ++ind)
-		{
-			r += (psi[ind] * psi[ind]);
-		}
-		r.transform(sqrtf);
-		r = (r * to) + 1;
-		for (auto ind = 0u; ind < dm; ++ind)
-		{
-			vP[ind] = (vP[ind] + psi[ind] * to);
-			vP[ind] /= r;
-		}
+		engine.setConfig(m_config);
 	}
-	out -= out.getDivergence(vP);
-	auto oper = [&](const float in)
-	{
-		return lambda * in;
-	};
-	out.transform(oper);
-
+	engine.template runBatch<IsIso>(pIn, pOut, size_, scaling, cnt);
 }
 
 template<typename TInputImage, typename TOutputImage>
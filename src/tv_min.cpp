@@ -7,6 +7,9 @@
 
 #include <iostream>
 #include <iomanip>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
 #include <string>
 #include <stdio.h>
 #include <new>
@@ -15,28 +18,30 @@
 #include "itkImage.h"
 #include "itkImageFileReader.h"
 #include "itkImageFileWriter.h"
+#include "itkImageIOFactory.h"
+#include "itkImportImageFilter.h"
 
 #include "ArgumentParser.hpp"
 #include "tv_filter.h"
+#include "tv_mapped_file.h"
+#include "tv_metaimage.h"
 
 using namespace std;
 
-int main(int argc, char * argv[])
+/*
+@brief: Runs the filter on the parsed arguments with the given pixel type used for
+both the input and the output images.
+@param: parser Parsed command line arguments.
+@return: Exit status.
+*/
+template<typename PixelType>
+int process(Cparser& parser)
 {
-	Cparser parser(argc, argv);
-	parser.save_key("in_file", "-in");
-	parser.save_key("out_file", "-out");
-	parser.save_key("lambda", "-l");
-	parser.save_key("iter", "-it");
-	parser.save_key("verbose", "-v");
-	parser.save_key("IsIsotropic", "-iso");
-	parser.save_key("SliceBySlice", "-slc");
-
-	typedef itk::Image<float, 3> InputImageType;
+	typedef itk::Image<PixelType, 3> InputImageType;
 	typedef itk::ImageFileReader<InputImageType> ReaderType;
-	ReaderType::Pointer reader = ReaderType::New();
+	typename ReaderType::Pointer reader = ReaderType::New();
 	typedef itk::TotalVariationMinimization<InputImageType, InputImageType> TV;
-	TV::Pointer Tv = TV::New();
+	typename TV::Pointer Tv = TV::New();
 
 	if (parser["in_file"].is_called())
 	{
@@ -45,6 +50,7 @@ int main(int argc, char * argv[])
 		Tv->SetInput(reader->GetOutput());
 		Tv->SetIsotropic(parser["IsIsotropic"].is_called());
 		Tv->SetSliceBySlice(parser["SliceBySlice"].is_called());
+		Tv->SetAutoTune(parser["AutoTune"].is_called());
 
 		auto lmbd = parser["lambda"].get_as_float();
 		if (!std::empty(lmbd))
@@ -64,7 +70,7 @@ int main(int argc, char * argv[])
 	if (parser["out_file"].is_called())
 	{
 		typedef itk::ImageFileWriter<InputImageType> WriterType;
-		WriterType::Pointer writer = WriterType::New();
+		typename WriterType::Pointer writer = WriterType::New();
 		writer->SetInput(Tv->GetOutput());
 		writer->SetFileName(parser["out_file"].get_as_string()[0]);
 		cout << "Out File:" << parser["out_file"].get_as_string()[0] << "\n";
@@ -85,3 +91,209 @@ int main(int argc, char * argv[])
 
 	return 0;
 }
+
+/*
+@brief: Runs the filter on memory mapped files. The mapped input voxels are the input of
+the filter and the output voxels are written by the solver directly into the mapped output
+file, so neither image is read or written as a whole.
+@param: parser Parsed command line arguments.
+@param: header Header of the uncompressed MetaImage input.
+@return: Exit status, -1 if the input can not be mapped and the files must be read instead.
+*/
+template<typename PixelType>
+int processMapped(Cparser& parser, const MetaImageHeader& header)
+{
+	const auto inFile = parser["in_file"].get_as_string()[0];
+	const auto outFile = parser["out_file"].get_as_string()[0];
+	auto outHeader = header;
+	const auto text = formatMetaImageHeader(outFile, outHeader);
+	/*Writing the output would truncate the mapped input*/
+	for (const auto& in : { inFile, header.dataFile })
+	{
+		for (const auto& out : { outFile, outHeader.dataFile })
+		{
+			std::error_code error;
+			if (std::filesystem::equivalent(in, out, error))
+				return -1;
+		}
+	}
+
+	const auto bytes = header.getCount() * sizeof(PixelType);
+	TVmappedFile inMap;
+	if (!inMap.openRead(header.dataFile) || inMap.size() < header.dataOffset + bytes)
+		return -1;
+	/*Voxels of a LOCAL header may start at any byte, the kernels need them aligned*/
+	if (0 != reinterpret_cast<std::uintptr_t>(inMap.data() + header.dataOffset) % alignof(PixelType))
+		return -1;
+	/*Voxels are visited plane by plane, read ahead keeps page faults cheap*/
+	inMap.adviseSequential();
+	cout << "In File:" << inFile << " (mapped)\n";
+	cout << "Out File:" << outFile << " (mapped)\n";
+
+	typedef itk::Image<PixelType, 3> ImageType;
+	typedef itk::ImportImageFilter<PixelType, 3> ImportType;
+	typename ImportType::Pointer importer = ImportType::New();
+	typename ImportType::IndexType start;
+	typename ImportType::SizeType size;
+	double spacing[3];
+	double origin[3] = { 0.0, 0.0, 0.0 };
+	typename ImportType::DirectionType direction;
+	direction.SetIdentity();
+	for (auto ind = 0u; ind < 3; ++ind)
+	{
+		start[ind] = 0;
+		size[ind] = header.size[ind];
+		spacing[ind] = header.spacing[ind];
+		if (3 == std::size(header.offset))
+			origin[ind] = header.offset[ind];
+		/*TransformMatrix holds the direction of an axis in consecutive values*/
+		for (auto d = 0u; d < 3 && 9 == std::size(header.direction); ++d)
+			direction[d][ind] = header.direction[ind * 3 + d];
+	}
+	importer->SetRegion(typename ImportType::RegionType(start, size));
+	importer->SetSpacing(spacing);
+	importer->SetOrigin(origin);
+	importer->SetDirection(direction);
+	/*Mapping is read only, the filter never writes its input*/
+	auto pIn = reinterpret_cast<PixelType*>(inMap.data() + header.dataOffset);
+	importer->SetImportPointer(pIn, header.getCount(), false);
+
+	typedef itk::TotalVariationMinimization<ImageType, ImageType> TV;
+	typename TV::Pointer Tv = TV::New();
+	Tv->SetInput(importer->GetOutput());
+	Tv->SetIsotropic(parser["IsIsotropic"].is_called());
+	Tv->SetSliceBySlice(parser["SliceBySlice"].is_called());
+	Tv->SetAutoTune(parser["AutoTune"].is_called());
+	auto lmbd = parser["lambda"].get_as_float();
+	if (!std::empty(lmbd))
+	{
+		Tv->SetLambda(lmbd[0]);
+	}
+	auto it = parser["iter"].get_as_integer();
+	if (!std::empty(it))
+	{
+		Tv->SetIt(it[0]);
+	}
+
+	{
+		std::ofstream file(outFile, std::ios::binary | std::ios::trunc);
+		file << text;
+		if (!file)
+		{
+			std::cerr << "Invalid output image" << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+	TVmappedFile outMap;
+	if (!outMap.openWrite(outHeader.dataFile, outHeader.dataOffset + bytes))
+	{
+		std::cerr << "Invalid output image" << std::endl;
+		return EXIT_FAILURE;
+	}
+	Tv->SetOutputBuffer(reinterpret_cast<PixelType*>(outMap.data() + outHeader.dataOffset));
+	try
+	{
+		Tv->Update();
+	}
+	catch (...)
+	{
+		std::cerr << "Invalid output image" << std::endl;
+		return EXIT_FAILURE;
+	}
+	if (!outMap.close())
+	{
+		std::cerr << "Invalid output image" << std::endl;
+		return EXIT_FAILURE;
+	}
+	return 0;
+}
+
+/*
+@brief: Maps the files and runs the filter on them if the input is an uncompressed 3D
+MetaImage and the output is a MetaImage too.
+@param: parser Parsed command line arguments.
+@return: Exit status, -1 if the files must be read instead.
+*/
+int processMapped(Cparser& parser)
+{
+	if (!parser["in_file"].is_called() || !parser["out_file"].is_called())
+		return -1;
+	const auto inFile = parser["in_file"].get_as_string()[0];
+	const auto outFile = parser["out_file"].get_as_string()[0];
+	MetaImageHeader header;
+	if (!isMetaImageFile(outFile) || !readMetaImageHeader(inFile, header) || !header.isRaw() || 3 != std::size(header.size))
+		return -1;
+	if ("MET_UCHAR" == header.elementType)
+		return processMapped<unsigned char>(parser, header);
+	if ("MET_SHORT" == header.elementType)
+		return processMapped<short>(parser, header);
+	if ("MET_USHORT" == header.elementType)
+		return processMapped<unsigned short>(parser, header);
+	return processMapped<float>(parser, header);
+}
+
+/*
+@brief: Gets the pixel component type stored in an image file without reading the image.
+@param: fileName Name of the image file.
+@return: Component type as string, empty if the file can not be read.
+*/
+std::string getComponentType(const std::string& fileName)
+{
+	auto imageIO = itk::ImageIOFactory::CreateImageIO(fileName.c_str(), itk::ImageIOFactory::ReadMode);
+	if (!imageIO)
+		return std::string();
+	try
+	{
+		imageIO->SetFileName(fileName);
+		imageIO->ReadImageInformation();
+	}
+	catch (...)
+	{
+		return std::string();
+	}
+	return imageIO->GetComponentTypeAsString(imageIO->GetComponentType());
+}
+
+int main(int argc, char * argv[])
+{
+	Cparser parser(argc, argv);
+	parser.save_key("in_file", "-in");
+	parser.save_key("out_file", "-out");
+	parser.save_key("lambda", "-l");
+	parser.save_key("iter", "-it");
+	parser.save_key("verbose", "-v");
+	parser.save_key("IsIsotropic", "-iso");
+	parser.save_key("SliceBySlice", "-slc");
+	parser.save_key("AutoTune", "-tune");
+	parser.save_key("MemoryMap", "-mmap");
+
+	if (parser["MemoryMap"].is_called())
+	{
+		const auto ret = processMapped(parser);
+		if (ret >= 0)
+		{
+			return ret;
+		}
+		std::cout << "Files can not be mapped, they are read instead" << std::endl;
+	}
+
+	/*Integer images are processed in their native pixel type, anything else as float*/
+	std::string componentType;
+	if (parser["in_file"].is_called())
+	{
+		componentType = getComponentType(parser["in_file"].get_as_string()[0]);
+	}
+	if ("unsigned_char" == componentType)
+	{
+		return process<unsigned char>(parser);
+	}
+	if ("short" == componentType)
+	{
+		return process<short>(parser);
+	}
+	if ("unsigned_short" == componentType)
+	{
+		return process<unsigned short>(parser);
+	}
+	return process<float>(parser);
+}